@@ -1,9 +1,248 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
 #include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 //the number of vertices
 
 #define N 6
 #define str "ABCDEFGHIJK"
+//trace level: 0 keeps the search silent, 1 prints the solution, 2 also
+//prints the explored and frontier sets at every iteration; the summary is
+//always printed at the end, build with -DTRACE=0 for large graphs; quiet
+//lowers the level at run time, the check mode sets it to 0
+#ifndef TRACE
+#define TRACE 2
+#endif
+int quiet = 0;
+#if TRACE >= 2
+#define trace(...) do { if (!quiet) printf(__VA_ARGS__); } while (0)
+#else
+#define trace(...) do { } while (0)
+#endif
+//summary of a search
+struct search_stats{
+	long expanded;     //number of expanded vertices
+	int max_frontier;  //largest size of the frontier
+	double cost;       //path cost, -1 when there is no solution
+	double elapsed;    //running time in seconds
+};
+//print the summary of a search
+void print_stats(search_stats &st){
+	printf("\n\n SUMMARY: expanded %ld, max frontier %d, path cost %0.1f, time %0.3f s\n",
+		st.expanded, st.max_frontier, st.cost, st.elapsed);
+}
+//wall-clock time in seconds: clock() adds up the processor time of all
+//threads, so it cannot time one query of a parallel batch; without OpenMP
+//there is one thread and clock() is enough
+double wall_time(){
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+//the name of vertex v: a letter of str for the first vertices, else its number
+const char *name(int v){
+	static char buf[16];
+	if (v < (int)sizeof(str) - 1){
+		buf[0] = str[v];
+		buf[1] = 0;
+	}
+	else
+		sprintf(buf,"%d",v);
+	return buf;
+}
+//graph in compressed sparse row form: the neighbors of vertex u are
+//adj[offset[u]], ..., adj[offset[u+1]-1] with the costs weight[...]
+struct csr_graph{
+	int n;          //number of vertices
+	int m;          //number of edges
+	int *offset;    //n+1 entries
+	int *adj;       //m entries
+	double *weight; //m entries, NULL for an unweighted graph
+	char *map;      //file mapping of a loaded graph, NULL when allocated
+	size_t map_size;
+};
+//build a csr graph from a cost matrix, a positive entry is an edge
+csr_graph csr_from_matrix(double graph[][N]){
+	csr_graph g;
+	g.n = N;
+	g.m = 0;
+	for (int i = 0; i<N; i++)
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] > 0)
+				g.m++;
+	g.map = NULL;
+	g.map_size = 0;
+	g.offset = (int*)malloc((g.n + 1) * sizeof(int));
+	g.adj = (int*)malloc((g.m > 0 ? g.m : 1) * sizeof(int));
+	g.weight = (double*)malloc((g.m > 0 ? g.m : 1) * sizeof(double));
+	int k = 0;
+	for (int i = 0; i<N; i++){
+		g.offset[i] = k;
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] > 0){
+				g.adj[k] = j;
+				g.weight[k] = graph[i][j];
+				k++;
+			}
+	}
+	g.offset[N] = k;
+	return g;
+}
+//binary graph file written by graph_converter: a header, offset[n+1] and
+//adj[m] as 32-bit integers, then weight[m] and the coordinates x[n], y[n]
+//as doubles when the flags say so; the doubles start at a multiple of 8
+#define GRAPH_MAGIC 0x47525343
+#define HAS_WEIGHTS 1
+#define HAS_COORDS  2
+struct graph_header{
+	int magic;     //"CSRG"
+	int version;   //1
+	int n, m;
+	int flags;
+	int reserved[3];
+};
+//unmap a file mapping
+void unmap(char *base, size_t size){
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+//map a binary graph file into memory: the arrays of g and the coordinates
+//x, y (NULL when absent) point into the mapping and pages are read on
+//first use, so loading does not depend on the size of the graph
+bool csr_map(const char *file, csr_graph &g, double *&x, double *&y){
+	char *base = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(f, &length) && length.QuadPart > 0){
+		size = (size_t)length.QuadPart;
+		HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL){
+			base = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(f);
+#else
+	int fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0){
+		size = (size_t)sb.st_size;
+		base = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (base == (char*)MAP_FAILED)
+			base = NULL;
+	}
+	close(fd);
+#endif
+	if (base == NULL)
+		return false;
+	graph_header *h = (graph_header*)base;
+	bool ok = size >= sizeof(graph_header) && h->magic == GRAPH_MAGIC && h->version == 1
+		&& h->n >= 0 && h->m >= 0;
+	size_t doubles = (sizeof(graph_header) + ((size_t)h->n + 1 + h->m) * sizeof(int) + 7) & ~(size_t)7;
+	size_t need = doubles;
+	if (h->flags & HAS_WEIGHTS)
+		need += (size_t)h->m * sizeof(double);
+	if (h->flags & HAS_COORDS)
+		need += 2 * (size_t)h->n * sizeof(double);
+	if (!ok || size < need){
+		unmap(base, size);
+		return false;
+	}
+	g.n = h->n;
+	g.m = h->m;
+	g.offset = (int*)(base + sizeof(graph_header));
+	g.adj = g.offset + g.n + 1;
+	g.weight = (h->flags & HAS_WEIGHTS) ? (double*)(base + doubles) : NULL;
+	x = y = NULL;
+	if (h->flags & HAS_COORDS){
+		x = (double*)(base + doubles) + ((h->flags & HAS_WEIGHTS) ? g.m : 0);
+		y = x + g.n;
+	}
+	g.map = base;
+	g.map_size = size;
+	return true;
+}
+//release a csr graph
+void csr_free(csr_graph &g){
+	if (g.map != NULL)
+		unmap(g.map, g.map_size);
+	else{
+		free(g.offset);
+		free(g.adj);
+		free(g.weight);
+	}
+	g.map = NULL;
+	g.offset = g.adj = NULL;
+	g.weight = NULL;
+	g.n = g.m = 0;
+}
+//states of a vertex during a search
+#define UNSEEN   0
+#define FRONTIER 1
+#define CLOSED   2
+//per-vertex search state packed in one word: the search generation in the
+//high bits and the state in the low two bits; a vertex stamped with an older
+//generation is UNSEEN, so a new search does not clear the array
+struct search_state{
+	int n;
+	unsigned int generation;
+	unsigned int *word;
+};
+//create the search state for n vertexs
+search_state state_create(int n){
+	search_state s;
+	s.n = n;
+	s.generation = 0;
+	s.word = (unsigned int*)calloc(n, sizeof(unsigned int));
+	return s;
+}
+//release the search state
+void state_free(search_state &s){
+	free(s.word);
+	s.word = NULL;
+}
+//start a new search, every vertex becomes UNSEEN
+void state_reset(search_state &s){
+	s.generation = (s.generation + 1) & 0x3FFFFFFF;
+	if (s.generation == 0){
+		//the generation wrapped around, clear the old stamps once
+		memset(s.word, 0, s.n * sizeof(unsigned int));
+		s.generation = 1;
+	}
+}
+//take the state of vertex v
+int state_get(search_state &s, int v){
+	unsigned int w = s.word[v];
+	return (w >> 2) == s.generation ? (int)(w & 3) : UNSEEN;
+}
+//set the state of vertex v
+void state_set(search_state &s, int v, int state){
+	s.word[v] = (s.generation << 2) | state;
+}
 //struct for a state
 struct vertex{
 	int n;
@@ -12,124 +251,509 @@ struct vertex{
 //display a queue
 void display(vertex queue[], int k){
 	for (int i = 0; i<k; i++)
-		printf("(%c,%0.1f),",str[queue[i].n],queue[i].f);
-}
-//take a node of the minimum g in a queue
-vertex pop(vertex queue[], int &k){
-	vertex node = queue[0];
-	int idx = 0;
-	for (int i = 1; i<k; i++){
-		if (node.f > queue[i].f){
-			node = queue[i];
-			idx = i;
-		}	
-	}
-	for (int i = idx; i<k; i++){
-		queue[i] = queue[i+1];
-	}
-	k = k - 1;
-	return node;
+		printf("(%s,%0.1f),",name(queue[i].n),queue[i].f);
 }
 //insert an element to a queue
 void insert(vertex queue[], int &k, vertex node){
 	queue[k] = node;
 	k = k + 1;	
 }
-//check an element in the queue
-bool exist(vertex queue[], int k, vertex node){
-	for (int i = 0; i<k; i++){
-		if (queue[i].n == node.n){
-			return true;
+//the number of children of a node in the frontier heap
+#define D 4
+//frontier as an indexed d-ary min-heap: slots are ordered by f and, for
+//equal f, by insertion order as in a linear frontier; pos[v] is the slot
+//of vertex v while v is in the FRONTIER state
+struct heap{
+	int size;
+	long next;     //insertion counter
+	vertex *node;  //slot -> vertex
+	long *order;   //slot -> insertion order
+	int *pos;      //vertex -> slot
+};
+//compare two slots of the heap
+bool heap_less(heap &h, int a, int b){
+	if (h.node[a].f != h.node[b].f)
+		return h.node[a].f < h.node[b].f;
+	return h.order[a] < h.order[b];
+}
+//exchange two slots of the heap
+void heap_swap(heap &h, int a, int b){
+	vertex node = h.node[a];
+	h.node[a] = h.node[b];
+	h.node[b] = node;
+	long order = h.order[a];
+	h.order[a] = h.order[b];
+	h.order[b] = order;
+	h.pos[h.node[a].n] = a;
+	h.pos[h.node[b].n] = b;
+}
+//move slot i towards the root
+void sift_up(heap &h, int i){
+	while (i > 0){
+		int p = (i - 1) / D;
+		if (!heap_less(h,i,p))
+			break;
+		heap_swap(h,i,p);
+		i = p;
+	}
+}
+//move slot i towards the leaves
+void sift_down(heap &h, int i){
+	while (true){
+		int best = i;
+		int first = D * i + 1;
+		for (int c = first; c < first + D && c < h.size; c++){
+			if (heap_less(h,c,best))
+				best = c;
 		}
+		if (best == i)
+			break;
+		heap_swap(h,i,best);
+		i = best;
 	}
-	return false;
+}
+//take a node of the minimum f in the frontier
+vertex pop(heap &h){
+	vertex node = h.node[0];
+	h.size = h.size - 1;
+	if (h.size > 0){
+		h.node[0] = h.node[h.size];
+		h.order[0] = h.order[h.size];
+		h.pos[h.node[0].n] = 0;
+		sift_down(h,0);
+	}
+	return node;
+}
+//insert an element to the frontier
+void insert(heap &h, vertex node){
+	int i = h.size;
+	h.size = h.size + 1;
+	h.node[i] = node;
+	h.order[i] = h.next++;
+	h.pos[node.n] = i;
+	sift_up(h,i);
+}
+//replace vertex node.n in the frontier by node with a lower f
+void decrease(heap &h, vertex node){
+	int i = h.pos[node.n];
+	h.node[i] = node;
+	sift_up(h,i);
+}
+//heuristic h(v, goal): an estimate of the cost from vertex v to goal
+typedef double (*heuristic)(int v, int goal);
+//take the next block of an arena, blocks are aligned to 16 bytes
+void *carve(char *&p, size_t bytes){
+	void *block = p;
+	p += (bytes + 15) & ~(size_t)15;
+	return block;
+}
+//workspace of a search: the search state, the frontier heap, the explored
+//set, the parent array and the best costs g, carved out of one arena block;
+//a thread keeps its workspace for all of its queries and the search state
+//resets by generation, so a query does not allocate or clear anything
+struct workspace{
+	char *arena;
+	search_state s;
+	heap frontier;
+	vertex *explored;
+	int *parent;
+	double *dist;
+};
+//create a workspace for n vertices and m edges, the heap has room for the
+//stale entries of the CONSISTENT mode, one per edge at most
+workspace workspace_create(int n, int m){
+	workspace w;
+	size_t capacity = (size_t)n + m + 1;
+	size_t bytes = (capacity + n) * sizeof(vertex) + capacity * sizeof(long)
+		+ n * sizeof(double) + 3 * n * sizeof(int) + 7 * 16;
+	w.arena = (char*)malloc(bytes);
+	char *p = w.arena;
+	w.frontier.node = (vertex*)carve(p, capacity * sizeof(vertex));
+	w.explored = (vertex*)carve(p, n * sizeof(vertex));
+	w.dist = (double*)carve(p, n * sizeof(double));
+	w.frontier.order = (long*)carve(p, capacity * sizeof(long));
+	w.frontier.pos = (int*)carve(p, n * sizeof(int));
+	w.parent = (int*)carve(p, n * sizeof(int));
+	w.s.n = n;
+	w.s.generation = 0;
+	w.s.word = (unsigned int*)carve(p, n * sizeof(unsigned int));
+	memset(w.s.word, 0, n * sizeof(unsigned int));
+	return w;
+}
+//release a workspace
+void workspace_free(workspace &w){
+	free(w.arena);
+	w.arena = NULL;
+}
+//take the path start -> goal from parent[], its number of vertices is k
+int *take_path(int parent[], int start, int goal, int &k)
+{
+	k = 1;
+	for (int node = goal; node != start; node = parent[node])
+		k++;
+	int *path = (int*)malloc(k * sizeof(int));
+	int i = k;
+	for (int node = goal; node != start; node = parent[node])
+		path[--i] = node;
+	path[0] = start;
+	return path;
 }
 //take the solution
-void solution(int parent[], vertex start, vertex goal){
-	int path[N];
+void solution(int parent[], int n, vertex start, vertex goal){
+	int *path = (int*)malloc(n * sizeof(int));
 	int k = 0, node = goal.n;
 	path[k++] = goal.n;
 	while (node != start.n){
 		node = parent[node];
 		path[k++] = node;
 	}
-	printf("\n\n SOLUTION:");
-	for (int i = k-1; i>=0; i--){
-		printf("%c->",str[path[i]]);
+#if TRACE >= 1
+	if (!quiet){
+		printf("\n\n SOLUTION:");
+		for (int i = k-1; i>=0; i--){
+			printf("%s->",name(path[i]));
+		}
 	}
+#endif
+	free(path);
 }
 
+//A* modes: CONSISTENT needs h(u) <= c(u,v) + h(v) on every edge, then a
+//vertex is closed once, a lower cost is pushed as a new heap entry and the
+//stale entries are skipped when popped; a closed vertex is never pushed
+//again, so an inconsistent h may give a longer path but stays in bounds;
+//REOPEN works with any admissible h, it lowers costs in place and moves a
+//closed vertex back to the frontier when a cheaper path reaches it
+#define CONSISTENT 0
+#define REOPEN 1
 //Astar algorithm
-void Astar(double graph[][N], double h[N], vertex start, vertex goal){	
+search_stats Astar(csr_graph &g, workspace &w, heuristic h, vertex start, vertex goal, int mode){	
     //struct for frontier, explored and parent
-	vertex frontier[N], explored[N];
-	//sizes of frontier and explores
-	int size_frontier = 0, size_explored = 0;
+	heap &frontier = w.frontier;
+	frontier.size = 0;
+	frontier.next = 0;
+	vertex *explored = w.explored;
+	//size of explores
+	int size_explored = 0;
+	search_state &s = w.s;
+	double *dist = w.dist;
 	
-	int parent[N];
+	int *parent = w.parent;
     parent[start.n] = start.n;
+	dist[start.n] = start.g;
+	search_stats st = {0, 1, -1, 0};
+	double t0 = wall_time();
    
-    insert(frontier,size_frontier,start);
+    state_reset(s);
+    state_set(s,start.n,FRONTIER);
+    insert(frontier,start);
 	int iter = 1;
-	while (true){
-		printf("\n\n -------- iteration %d -----------",iter);
-		vertex node = pop(frontier,size_frontier);		
+	while (frontier.size > 0){
+		vertex node = pop(frontier);		
+		//a stale entry of a closed vertex
+		if (state_get(s,node.n) == CLOSED)
+			continue;
+		trace("\n\n -------- iteration %d -----------",iter);
 		//check goal
 		if (node.n == goal.n){
-			printf("\n take vertex %c -> stop.",str[node.n]);
-			solution(parent,start,goal);
-			printf("\n PATH -COST: %0.1f",node.f);
-			return;
+			trace("\n take vertex %s -> stop.",name(node.n));
+			solution(parent,g.n,start,goal);
+#if TRACE >= 1
+			if (!quiet)
+				printf("\n PATH -COST: %0.1f",node.g);
+#endif
+			st.cost = node.g;
+			break;
 		}
-		insert(explored,size_explored,node);
-		printf("\n take vertex: %c ->",str[node.n]);		
-		for (int j = 0; j<N; j++){
-			if (graph[node.n][j] > 0){
-				vertex child;
-				child.n = j;
-				child.h = h[j];			
-				if (!(exist(explored,size_explored,child)||exist(frontier,size_frontier,child))){
-					parent[child.n] = node.n;					
-					//compute f(n) = g(n) + h(n)
-					child.g = node.g + graph[node.n][j];
-					child.f = child.g + child.h;
-					//insert child to frontier 
-					insert(frontier,size_frontier,child);					
-					printf("%c, ",str[child.n]);
-				}			
-				else{				
-					if (exist(frontier,size_frontier,child)){
-						//find the index of child in the frontier
-						int idx = 0;
-						for (int i = 0; i < size_frontier; i++){
-							if (frontier[i].n == child.n){
-								idx = i;
-								break;
-							}
-						}
-						//replace the mininum node with child
-						if (frontier[idx].f > node.g + graph[node.n][j] + h[j]){
-							parent[child.n] = node.n;
-							frontier[idx].f = node.g + graph[node.n][j] + h[j];
-							printf("%c, ",str[child.n]);
-						}
-						else{
-							printf("|");
-						}
-												
-					}
+		state_set(s,node.n,CLOSED);
+		//a reopened vertex is listed again, the list keeps n entries
+		if (size_explored < g.n)
+			insert(explored,size_explored,node);
+		st.expanded++;
+		trace("\n take vertex: %s ->",name(node.n));		
+		//only the neighbors of node are visited
+		for (int e = g.offset[node.n]; e<g.offset[node.n+1]; e++){
+			vertex child;
+			child.n = g.adj[e];
+			child.g = node.g + g.weight[e];
+			int state = state_get(s,child.n);
+			//CONSISTENT closes a vertex once, so each edge pushes at most
+			//one entry and the heap of n+m+1 entries cannot overflow even
+			//when h is not consistent
+			if (state == CLOSED && mode == CONSISTENT)
+				continue;
+			if (state != UNSEEN && child.g >= dist[child.n]){
+				if (state == FRONTIER){
+					trace("|");
 				}
+				continue;
+			}
+			//compute f(n) = g(n) + h(n)
+			child.h = h(child.n,goal.n);
+			child.f = child.g + child.h;
+			parent[child.n] = node.n;
+			dist[child.n] = child.g;
+			if (state == FRONTIER && mode == REOPEN){
+				//lower the cost of child in the frontier
+				decrease(frontier,child);
 			}
+			else{
+				//a new vertex, a cheaper entry of a vertex in the frontier
+				//(the old one becomes stale) or a reopened vertex
+				state_set(s,child.n,FRONTIER);
+				insert(frontier,child);
+			}
+			if (frontier.size > st.max_frontier)
+				st.max_frontier = frontier.size;
+			trace("%s, ",name(child.n));
+		}
+#if TRACE >= 2
+		if (!quiet){
+			printf("\n explored set:");
+			display(explored,size_explored);		
+			printf("\n frontier set:");
+			display(frontier.node,frontier.size);				
 		}
-		printf("\n explored set:");
-		display(explored,size_explored);		
-		printf("\n frontier set:");
-		display(frontier,size_frontier);				
+#endif
 	    iter++;
 	}
+#if TRACE >= 1
+	if (st.cost < 0 && !quiet)
+		printf("\n\n There exists no solution.");
+#endif
+	st.elapsed = wall_time() - t0;
+	return st;
 }
-//main
-int main(){
+//Dijkstra's algorithm on arrays, O(n^2): a plain oracle for the cost of a
+//shortest path start -> goal, -1 when there is no path
+double dijkstra(csr_graph &g, int start, int goal){
+	double *d = (double*)malloc(g.n * sizeof(double));
+	bool *done = (bool*)calloc(g.n, sizeof(bool));
+	for (int v = 0; v<g.n; v++)
+		d[v] = INFINITY;
+	d[start] = 0;
+	while (true){
+		int u = -1;
+		for (int v = 0; v<g.n; v++)
+			if (!done[v] && d[v] < INFINITY && (u < 0 || d[v] < d[u]))
+				u = v;
+		if (u < 0 || u == goal)
+			break;
+		done[u] = true;
+		for (int e = g.offset[u]; e<g.offset[u+1]; e++)
+			if (d[u] + g.weight[e] < d[g.adj[e]])
+				d[g.adj[e]] = d[u] + g.weight[e];
+	}
+	double cost = d[goal] < INFINITY ? d[goal] : -1;
+	free(d);
+	free(done);
+	return cost;
+}
+//coordinates of the vertices for the straight-line heuristics
+double *coord_x, *coord_y;
+//no estimate at all
+double h_zero(int /*v*/, int /*goal*/){
+	return 0;
+}
+//factor of the straight-line heuristic, 1 in the check mode where no edge
+//is shorter than its length; a graph file sets it with consistent_scale
+double coord_scale = 1;
+//straight-line distance to goal times coord_scale
+double h_euclid(int v, int goal){
+	double dx = coord_x[v] - coord_x[goal], dy = coord_y[v] - coord_y[goal];
+	return coord_scale * sqrt(dx*dx + dy*dy);
+}
+//the largest s with s * |uv| <= c(u,v) on every edge (u,v), found in one
+//pass over the edges: s times the straight-line distance is consistent
+//whatever the units of the coordinates; INFINITY when no edge has a
+//positive length
+double consistent_scale(csr_graph &g){
+	double s = INFINITY;
+	for (int u = 0; u<g.n; u++)
+		for (int e = g.offset[u]; e<g.offset[u+1]; e++){
+			int v = g.adj[e];
+			double dx = coord_x[u] - coord_x[v], dy = coord_y[u] - coord_y[v];
+			double d = sqrt(dx*dx + dy*dy);
+			if (d > 0 && g.weight[e] < s * d)
+				s = g.weight[e] / d;
+		}
+	return s;
+}
+//the straight-line distance scaled by a fixed factor in [0,1) per vertex:
+//admissible but in general not consistent
+double h_scaled(int v, int goal){
+	unsigned int x = (unsigned int)v * 2654435761u;
+	return h_euclid(v,goal) * ((x >> 16) % 1000) / 1000.0;
+}
+//check Astar against dijkstra on a random graph of n points in the plane:
+//CONSISTENT and REOPEN with h_euclid, REOPEN with h_scaled; returns the
+//number of wrong costs
+int validate(int n, int queries){
+	const int k = 4;
+	quiet = 1;
+	csr_graph g;
+	g.n = n;
+	g.m = n * k;
+	g.map = NULL;
+	g.map_size = 0;
+	g.offset = (int*)malloc((n + 1) * sizeof(int));
+	g.adj = (int*)malloc(g.m * sizeof(int));
+	g.weight = (double*)malloc(g.m * sizeof(double));
+	coord_x = (double*)malloc(n * sizeof(double));
+	coord_y = (double*)malloc(n * sizeof(double));
+	srand(1);
+	for (int v = 0; v<n; v++){
+		coord_x[v] = rand() % 1000;
+		coord_y[v] = rand() % 1000;
+	}
+	//k random edges per vertex, none is shorter than the straight line
+	for (int u = 0; u<n; u++){
+		g.offset[u] = u * k;
+		for (int i = 0; i<k; i++){
+			int v = (u + 1 + rand() % 50) % n;
+			g.adj[u*k + i] = v;
+			g.weight[u*k + i] = h_euclid(u,v) * (1 + (rand() % 100) / 100.0) + 1;
+		}
+	}
+	g.offset[n] = g.m;
+	workspace w = workspace_create(g.n,g.m);
+	heuristic hs[3] = {h_euclid, h_euclid, h_scaled};
+	int modes[3] = {CONSISTENT, REOPEN, REOPEN};
+	int wrong = 0;
+	long expanded[3] = {0, 0, 0};
+	for (int q = 0; q<queries; q++){
+		int a = rand() % n, b = rand() % n;
+		double cost = dijkstra(g,a,b);
+		for (int t = 0; t<3; t++){
+			vertex start = {a, 0, hs[t](a,b), hs[t](a,b)}, goal = {b, 0, 0, 0};
+			search_stats st = Astar(g,w,hs[t],start,goal,modes[t]);
+			expanded[t] += st.expanded;
+			if (fabs(st.cost - cost) > 1e-6)
+				wrong++;
+		}
+	}
+	printf("\n CHECK: %d queries on %d vertices, %d wrong costs", queries, n, wrong);
+	printf("\n expanded: consistent %ld, reopen %ld, reopen inconsistent h %ld\n",
+		expanded[0], expanded[1], expanded[2]);
+	workspace_free(w);
+	csr_free(g);
+	free(coord_x);
+	free(coord_y);
+	quiet = 0;
+	return wrong;
+}
+//heuristic of the example graph, the goal is F
+double h_table[N] = {6,5,4,2,3,0};
+double h_example(int v, int /*goal*/){
+	return h_table[v];
+}
+//result of a query
+struct query_result{
+	int start, goal;
+	double cost;     //-1 when there is no path
+	int length;      //number of vertices on the path
+	int *path;       //start, ..., goal
+	search_stats st;
+};
+//query engine: a graph and one workspace per thread
+struct query_engine{
+	csr_graph *g;
+	heuristic h;
+	int mode;
+	int threads;
+	workspace *w;
+};
+//create a query engine on graph g with the heuristic h and an A* mode
+query_engine engine_create(csr_graph &g, heuristic h, int mode){
+	query_engine q;
+	q.g = &g;
+	q.h = h;
+	q.mode = mode;
+#ifdef _OPENMP
+	q.threads = omp_get_max_threads();
+#else
+	q.threads = 1;
+#endif
+	q.w = (workspace*)malloc(q.threads * sizeof(workspace));
+	for (int t = 0; t<q.threads; t++)
+		q.w[t] = workspace_create(g.n,g.m);
+	return q;
+}
+//release a query engine
+void engine_free(query_engine &q){
+	for (int t = 0; t<q.threads; t++)
+		workspace_free(q.w[t]);
+	free(q.w);
+}
+//answer a batch of queries (start, goal) on the threads of the engine; a
+//traced build runs on one thread so that the output stays in order
+void engine_run(query_engine &q, int queries[][2], int count, query_result result[]){
+	#pragma omp parallel for schedule(dynamic) if (TRACE == 0)
+	for (int i = 0; i<count; i++){
+#ifdef _OPENMP
+		workspace &w = q.w[omp_get_thread_num()];
+#else
+		workspace &w = q.w[0];
+#endif
+		query_result &r = result[i];
+		r.start = queries[i][0];
+		r.goal = queries[i][1];
+		double h = q.h(r.start,r.goal);
+		vertex start = {r.start, 0, h, h}, goal = {r.goal, 0, 0, 0};
+		r.st = Astar(*q.g,w,q.h,start,goal,q.mode);
+		r.cost = r.st.cost;
+		r.length = 0;
+		r.path = r.cost >= 0 ? take_path(w.parent,r.start,r.goal,r.length) : NULL;
+	}
+}
+//release the paths of a batch
+void result_free(query_result result[], int count){
+	for (int i = 0; i<count; i++){
+		free(result[i].path);
+		result[i].path = NULL;
+	}
+}
+//main, "Astar check" validates Astar against dijkstra and "Astar file start
+//goal" searches a graph file; the coordinates of a file need not be in
+//the units of the costs, so the straight-line heuristic is scaled by the
+//minimum cost per unit of length over all edges, which makes it consistent
+//and lets the file search use the CONSISTENT mode; REOPEN is left to the
+//example h
+int main(int argc, char *argv[]){
+	if (argc > 1 && strcmp(argv[1],"check") == 0)
+		return validate(2000,200) == 0 ? 0 : 1;
+	if (argc > 3){
+		csr_graph g;
+		if (!csr_map(argv[1],g,coord_x,coord_y) || g.weight == NULL){
+			printf("\n cannot load the weighted graph %s\n",argv[1]);
+			return 1;
+		}
+		int a = atoi(argv[2]), b = atoi(argv[3]);
+		if (a < 0 || a >= g.n || b < 0 || b >= g.n){
+			printf("\n no vertex %d or %d\n",a,b);
+			csr_free(g);
+			return 1;
+		}
+		//the straight-line distance is scaled down to the cheapest edge per
+		//unit of length; without coordinates, or when the scale gives no
+		//estimate, A* becomes Dijkstra's algorithm
+		heuristic h = h_zero;
+		if (coord_x != NULL){
+			coord_scale = consistent_scale(g);
+			if (coord_scale > 0 && coord_scale < INFINITY)
+				h = h_euclid;
+#if TRACE >= 1
+			printf("\n straight-line heuristic scale: %g",coord_scale);
+#endif
+		}
+		vertex start = {a, 0, h(a,b), h(a,b)}, goal = {b, 0, 0, 0};
+		workspace w = workspace_create(g.n,g.m);
+		search_stats st = Astar(g,w,h,start,goal,CONSISTENT);
+		print_stats(st);
+		workspace_free(w);
+		csr_free(g);
+		return 0;
+	}
 	double graph[N][N] = {
         {0, 2, 7, 0, 0, 0},
         {2, 0, 0, 3, 1, 0},
@@ -138,10 +762,30 @@ int main(){
         {0, 1, 0, 2, 0, 0},
         {0, 0, 5, 4, 0, 0}
     };  
-    double h[N] = {6,5,4,2,3,0};
 	vertex start = {0,0,6,6};
 	vertex goal  = {5,0,0,0};
 	
-	Astar(graph,h,start,goal);
+	csr_graph g = csr_from_matrix(graph);
+	workspace w = workspace_create(g.n,g.m);
+	//the example heuristic is not consistent: h(B) > c(B,E) + h(E)
+	search_stats st = Astar(g,w,h_example,start,goal,REOPEN);
+	print_stats(st);
+	workspace_free(w);
+	//a batch of queries on the engine, the example heuristic only suits F
+	int queries[3][2] = {{0, 5}, {1, 5}, {4, 5}};
+	query_result result[3];
+	query_engine q = engine_create(g,h_example,REOPEN);
+	engine_run(q,queries,3,result);
+	printf("\n BATCH:");
+	for (int i = 0; i<3; i++){
+		printf("\n %s -> ",name(result[i].start));
+		printf("%s: cost %0.1f, path ",name(result[i].goal),result[i].cost);
+		for (int k = 0; k<result[i].length; k++)
+			printf("%s->",name(result[i].path[k]));
+	}
+	printf("\n");
+	result_free(result,3);
+	engine_free(q);
+	csr_free(g);
 	return 0;
 }
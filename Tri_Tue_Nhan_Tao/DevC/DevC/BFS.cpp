@@ -1,100 +1,711 @@
 //programmed by HOANG HUU VIET
 #include <stdio.h>
-#include <conio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#ifdef _WIN32
+#include <conio.h>
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 //the number of nodes
 #define N 6
 //#define N 500
+//trace level: 0 keeps the search silent, 1 prints the solution, 2 also
+//prints the explored and frontier sets at every iteration; the summary is
+//always printed at the end, build with -DTRACE=0 for large graphs
+#ifndef TRACE
+#define TRACE 2
+#endif
+#if TRACE >= 2
+#define trace(...) printf(__VA_ARGS__)
+#else
+#define trace(...) do { } while (0)
+#endif
+//summary of a search
+struct search_stats{
+	long expanded;     //number of expanded nodes
+	int max_frontier;  //largest size of the frontier
+	double cost;       //path cost, -1 when there is no solution
+	double elapsed;    //running time in seconds
+};
+//print the summary of a search
+void print_stats(search_stats &st){
+	printf("\n\n SUMMARY: expanded %ld, max frontier %d, path cost %0.1f, time %0.3f s\n",
+		st.expanded, st.max_frontier, st.cost, st.elapsed);
+}
+//wall-clock time in seconds: clock() adds up the processor time of all
+//threads, so it cannot time a parallel step or one query of a batch;
+//without OpenMP there is one thread and clock() is enough
+double wall_time(){
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+//graph in compressed sparse row form: the neighbors of node u are
+//adj[offset[u]], ..., adj[offset[u+1]-1]
+struct csr_graph{
+	int n;          //number of nodes
+	int m;          //number of edges
+	int *offset;    //n+1 entries
+	int *adj;       //m entries
+	double *weight; //m entries, NULL for an unweighted graph
+	char *map;      //file mapping of a loaded graph, NULL when allocated
+	size_t map_size;
+};
+//build a csr graph from an adjacency matrix
+csr_graph csr_from_matrix(int graph[][N]){
+	csr_graph g;
+	g.n = N;
+	g.m = 0;
+	for (int i = 0; i<N; i++)
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] == 1)
+				g.m++;
+	g.map = NULL;
+	g.map_size = 0;
+	g.offset = (int*)malloc((g.n + 1) * sizeof(int));
+	g.adj = (int*)malloc((g.m > 0 ? g.m : 1) * sizeof(int));
+	g.weight = NULL;
+	int k = 0;
+	for (int i = 0; i<N; i++){
+		g.offset[i] = k;
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] == 1)
+				g.adj[k++] = j;
+	}
+	g.offset[N] = k;
+	return g;
+}
+//binary graph file written by graph_converter: a header, offset[n+1] and
+//adj[m] as 32-bit integers, then weight[m] and the coordinates x[n], y[n]
+//as doubles when the flags say so; the doubles start at a multiple of 8
+#define GRAPH_MAGIC 0x47525343
+#define HAS_WEIGHTS 1
+#define HAS_COORDS  2
+struct graph_header{
+	int magic;     //"CSRG"
+	int version;   //1
+	int n, m;
+	int flags;
+	int reserved[3];
+};
+//unmap a file mapping
+void unmap(char *base, size_t size){
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+//map a binary graph file into memory: the arrays of g and the coordinates
+//x, y (NULL when absent) point into the mapping and pages are read on
+//first use, so loading does not depend on the size of the graph
+bool csr_map(const char *file, csr_graph &g, double *&x, double *&y){
+	char *base = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(f, &length) && length.QuadPart > 0){
+		size = (size_t)length.QuadPart;
+		HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL){
+			base = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(f);
+#else
+	int fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0){
+		size = (size_t)sb.st_size;
+		base = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (base == (char*)MAP_FAILED)
+			base = NULL;
+	}
+	close(fd);
+#endif
+	if (base == NULL)
+		return false;
+	graph_header *h = (graph_header*)base;
+	bool ok = size >= sizeof(graph_header) && h->magic == GRAPH_MAGIC && h->version == 1
+		&& h->n >= 0 && h->m >= 0;
+	size_t doubles = (sizeof(graph_header) + ((size_t)h->n + 1 + h->m) * sizeof(int) + 7) & ~(size_t)7;
+	size_t need = doubles;
+	if (h->flags & HAS_WEIGHTS)
+		need += (size_t)h->m * sizeof(double);
+	if (h->flags & HAS_COORDS)
+		need += 2 * (size_t)h->n * sizeof(double);
+	if (!ok || size < need){
+		unmap(base, size);
+		return false;
+	}
+	g.n = h->n;
+	g.m = h->m;
+	g.offset = (int*)(base + sizeof(graph_header));
+	g.adj = g.offset + g.n + 1;
+	g.weight = (h->flags & HAS_WEIGHTS) ? (double*)(base + doubles) : NULL;
+	x = y = NULL;
+	if (h->flags & HAS_COORDS){
+		x = (double*)(base + doubles) + ((h->flags & HAS_WEIGHTS) ? g.m : 0);
+		y = x + g.n;
+	}
+	g.map = base;
+	g.map_size = size;
+	return true;
+}
+//release a csr graph
+void csr_free(csr_graph &g){
+	if (g.map != NULL)
+		unmap(g.map, g.map_size);
+	else{
+		free(g.offset);
+		free(g.adj);
+		free(g.weight);
+	}
+	g.map = NULL;
+	g.offset = g.adj = NULL;
+	g.weight = NULL;
+	g.n = g.m = 0;
+}
+//build the reverse graph, u -> v becomes v -> u
+csr_graph csr_reverse(csr_graph &g){
+	csr_graph r;
+	r.n = g.n;
+	r.m = g.m;
+	r.map = NULL;
+	r.map_size = 0;
+	r.offset = (int*)calloc(r.n + 1, sizeof(int));
+	r.adj = (int*)malloc((r.m > 0 ? r.m : 1) * sizeof(int));
+	r.weight = g.weight != NULL ? (double*)malloc((r.m > 0 ? r.m : 1) * sizeof(double)) : NULL;
+	//count the in-degrees, then place every edge after its target
+	for (int e = 0; e<g.m; e++)
+		r.offset[g.adj[e] + 1]++;
+	for (int v = 0; v<r.n; v++)
+		r.offset[v + 1] += r.offset[v];
+	int *next = (int*)malloc((r.n > 0 ? r.n : 1) * sizeof(int));
+	memcpy(next, r.offset, r.n * sizeof(int));
+	for (int u = 0; u<g.n; u++){
+		for (int e = g.offset[u]; e<g.offset[u+1]; e++){
+			int k = next[g.adj[e]]++;
+			r.adj[k] = u;
+			if (r.weight != NULL)
+				r.weight[k] = g.weight[e];
+		}
+	}
+	free(next);
+	return r;
+}
+//fifo queue in a ring buffer
+struct fifo{
+	int capacity;
+	int head;   //slot of the first element
+	int size;
+	int *node;
+};
+//create an empty fifo queue
+fifo fifo_create(int capacity){
+	fifo q;
+	q.capacity = capacity;
+	q.head = 0;
+	q.size = 0;
+	q.node = (int*)malloc(capacity * sizeof(int));
+	return q;
+}
+//release a fifo queue
+void fifo_free(fifo &q){
+	free(q.node);
+	q.node = NULL;
+}
 //display the frontier and explored sets
-void display(int queue[], int k){
-	for (int i = 0; i<k; i++)
-		printf("%5d",queue[i]);
+void display(fifo &q){
+	int i = q.head;
+	for (int k = 0; k<q.size; k++){
+		printf("%5d",q.node[i]);
+		i = i+1 == q.capacity ? 0 : i+1;
+	}
 }
 //take the top element of the frontier
-int pop(int queue[], int &k){
-	int node = queue[0];
-	for (int i = 0; i<k; i++){
-		queue[i] = queue[i+1];
-	}
-	k = k-1;
+int pop(fifo &q){
+	int node = q.node[q.head];
+	q.head = q.head+1 == q.capacity ? 0 : q.head+1;
+	q.size = q.size-1;
 	return node;
 }
 //insert an element to the fifo queue
-void insert(int queue[], int &k, int node){
-	queue[k] = node;
-	k = k+1;
-}
-//check an element in the frontier and explored sets
-bool exist(int queue[], int k, int node){
-	for (int i = 0; i<k; i++){
-		if (queue[i] == node){
-			return true;
-		}
+void insert(fifo &q, int node){
+	int tail = q.head + q.size;
+	if (tail >= q.capacity)
+		tail = tail - q.capacity;
+	q.node[tail] = node;
+	q.size = q.size+1;
+}
+//states of a node during a search
+#define UNSEEN   0
+#define FRONTIER 1
+#define CLOSED   2
+//per-node search state packed in one word: the search generation in the
+//high bits and the state in the low two bits; a node stamped with an older
+//generation is UNSEEN, so a new search does not clear the array
+struct search_state{
+	int n;
+	unsigned int generation;
+	unsigned int *word;
+};
+//create the search state for n nodes
+search_state state_create(int n){
+	search_state s;
+	s.n = n;
+	s.generation = 0;
+	s.word = (unsigned int*)calloc(n, sizeof(unsigned int));
+	return s;
+}
+//release the search state
+void state_free(search_state &s){
+	free(s.word);
+	s.word = NULL;
+}
+//start a new search, every node becomes UNSEEN
+void state_reset(search_state &s){
+	s.generation = (s.generation + 1) & 0x3FFFFFFF;
+	if (s.generation == 0){
+		//the generation wrapped around, clear the old stamps once
+		memset(s.word, 0, s.n * sizeof(unsigned int));
+		s.generation = 1;
 	}
-	return false;
 }
-//print solution
-void solution(int parent[], int start, int goal)
+//take the state of node v
+int state_get(search_state &s, int v){
+	unsigned int w = s.word[v];
+	return (w >> 2) == s.generation ? (int)(w & 3) : UNSEEN;
+}
+//set the state of node v
+void state_set(search_state &s, int v, int state){
+	s.word[v] = (s.generation << 2) | state;
+}
+//workspace of a search: the search state, the frontier and explored
+//queues and the parent array, carved out of one arena block; a thread
+//keeps its workspace for all of its queries and the search state resets
+//by generation, so a query does not allocate or clear anything
+struct workspace{
+	char *arena;
+	search_state s;
+	fifo frontier, explored;
+	int *parent;
+};
+//create a workspace for n nodes
+workspace workspace_create(int n){
+	workspace w;
+	w.arena = (char*)malloc((4 * (size_t)n + 1) * sizeof(int));
+	int *p = (int*)w.arena;
+	w.s.n = n;
+	w.s.generation = 0;
+	w.s.word = (unsigned int*)p;
+	memset(w.s.word, 0, n * sizeof(unsigned int));
+	p += n;
+	w.frontier.capacity = w.explored.capacity = n;
+	w.frontier.node = p;
+	p += n;
+	w.explored.node = p;
+	p += n;
+	w.parent = p;
+	return w;
+}
+//release a workspace
+void workspace_free(workspace &w){
+	free(w.arena);
+	w.arena = NULL;
+}
+//print solution and return the number of edges on the path
+int solution(int parent[], int n, int start, int goal)
 {
-	int path[N];
+	int *path = (int*)malloc(n * sizeof(int));
 	int k = 0;
 	path[k++] = goal;
 	int node = goal;
-	while (parent[node] != start){
+	while (node != start){
 		node = parent[node];
 		path[k++] = node;
 	}
-	path[k++] = start; 
+#if TRACE >= 1
 	printf("\n\n SOLUTION:");
 	for (int i = k-1; i>=0; i--){
 		printf("%5d",path[i]);
-	}	
+	}
+#endif
+	free(path);
+	return k-1;
 }
 
+//take the path start -> goal from parent[], its number of nodes is k
+int *take_path(int parent[], int start, int goal, int &k)
+{
+	k = 1;
+	for (int node = goal; node != start; node = parent[node])
+		k++;
+	int *path = (int*)malloc(k * sizeof(int));
+	int i = k;
+	for (int node = goal; node != start; node = parent[node])
+		path[--i] = node;
+	path[0] = start;
+	return path;
+}
 //BFS algorithm
-void bfs(int graph[][N], int start, int goal)
+search_stats bfs(csr_graph &g, workspace &w, int start, int goal)
 {
-	int frontier[N] = {0}, explored[N] = {0}, parent[N] = {0};
-	//sizes of frontier and explores
-	int n = 0, m = 0;
+	//every node enters the frontier and explored sets at most once
+	fifo &frontier = w.frontier, &explored = w.explored;
+	frontier.head = frontier.size = 0;
+	explored.head = explored.size = 0;
+	search_state &s = w.s;
+	int *parent = w.parent;
+	search_stats st = {0, 1, -1, 0};
+	double t0 = wall_time();
 	int node = start;
 	parent[node] = node;
 	
-	insert(frontier,n,node);	
-	bool stop = false;
+	state_reset(s);
+	state_set(s,node,FRONTIER);
+	insert(frontier,node);	
+	//the goal is only tested on generated children, so test the start here
+	if (start == goal)
+		st.cost = solution(parent,g.n,start,goal);
 	int iter = 1;
-	while (true){		
-		printf("\n\n -------- iteration %d -----------",iter);
-		node = pop(frontier,n);		
-		insert(explored,m,node);
+	while (st.cost < 0 && frontier.size > 0){		
+		trace("\n\n -------- iteration %d -----------",iter);
+		node = pop(frontier);		
+		state_set(s,node,CLOSED);
+		insert(explored,node);
+		st.expanded++;
 				
-		printf("\n node: %5d ->",node);		
-		for (int j = 0; j<N; j++){
-			if (graph[node][j] == 1){
-				int child = j;
-				if (!(exist(explored,m,child)||exist(frontier,n,child))){
-					parent[child] = node;
-					printf("%5d",child);
-					if (child == goal){						
-						solution(parent,start,goal);
-						return;
-					}
-					insert(frontier,n,child);
+		trace("\n node: %5d ->",node);		
+		//only the neighbors of node are visited
+		for (int e = g.offset[node]; e<g.offset[node+1]; e++){
+			int child = g.adj[e];
+			if (state_get(s,child) == UNSEEN){
+				parent[child] = node;
+				trace("%5d",child);
+				if (child == goal){						
+					st.cost = solution(parent,g.n,start,goal);
+					break;
 				}
+				state_set(s,child,FRONTIER);
+				insert(frontier,child);
+				if (frontier.size > st.max_frontier)
+					st.max_frontier = frontier.size;
 			}
 		}
+		if (st.cost >= 0)
+			break;
+#if TRACE >= 2
 		printf("\n explored set:");
-		display(explored,m);		
+		display(explored);		
 		printf("\n frontier set:");
-		display(frontier,n);
+		display(frontier);
+#endif
 	    iter++;
 	}
-	
+#if TRACE >= 1
+	if (st.cost < 0)
+		printf("\n\n There exists no solution.");
+#endif
+	st.elapsed = wall_time() - t0;
+	return st;
+}
+//expand one level of a bidirectional BFS: the nodes now in q are taken
+//out and their unseen neighbors in g enter q; returns a node already seen
+//by the other search (state other), or -1
+int expand_level(csr_graph &g, fifo &q, search_state &s, search_state &other,
+	int parent[], search_stats &st)
+{
+	int size = q.size;
+	for (int k = 0; k<size; k++){
+		int node = pop(q);
+		state_set(s,node,CLOSED);
+		st.expanded++;
+		trace("\n node: %5d ->",node);
+		for (int e = g.offset[node]; e<g.offset[node+1]; e++){
+			int child = g.adj[e];
+			if (state_get(s,child) == UNSEEN){
+				parent[child] = node;
+				trace("%5d",child);
+				if (state_get(other,child) != UNSEEN)
+					return child;
+				state_set(s,child,FRONTIER);
+				insert(q,child);
+			}
+		}
+	}
+	return -1;
 }
-//the main program
-int main(){		
+//bidirectional BFS: a forward search from start on g and a backward search
+//from goal on the reverse graph r expand whole levels, the smaller frontier
+//first; the first node seen by both ends a shortest path
+search_stats bfs_bidirectional(csr_graph &g, csr_graph &r, search_state &fs, search_state &bs,
+	int start, int goal)
+{
+	fifo qf = fifo_create(g.n), qb = fifo_create(g.n);
+	int *parent = (int*)calloc(g.n, sizeof(int));
+	int *parent_b = (int*)calloc(g.n, sizeof(int));
+	search_stats st = {0, 2, -1, 0};
+	double t0 = wall_time();
+	parent[start] = start;
+	parent_b[goal] = goal;
+	state_reset(fs);
+	state_reset(bs);
+	state_set(fs,start,FRONTIER);
+	state_set(bs,goal,FRONTIER);
+	insert(qf,start);
+	insert(qb,goal);
+	int meet = start == goal ? start : -1;
+	int iter = 1;
+	while (meet < 0 && qf.size > 0 && qb.size > 0){
+		trace("\n\n -------- iteration %d -----------",iter);
+		if (qf.size <= qb.size){
+			trace("\n forward");
+			meet = expand_level(g,qf,fs,bs,parent,st);
+		}
+		else{
+			trace("\n backward");
+			meet = expand_level(r,qb,bs,fs,parent_b,st);
+		}
+		if (qf.size + qb.size > st.max_frontier)
+			st.max_frontier = qf.size + qb.size;
+	    iter++;
+	}
+	if (meet >= 0){
+		//stitch the backward chain from meet to goal onto the forward one
+		int node = meet;
+		while (node != goal){
+			int next = parent_b[node];
+			parent[next] = node;
+			node = next;
+		}
+		st.cost = solution(parent,g.n,start,goal);
+	}
+#if TRACE >= 1
+	else
+		printf("\n\n There exists no solution.");
+#endif
+	fifo_free(qf);
+	fifo_free(qb);
+	free(parent);
+	free(parent_b);
+	st.elapsed = wall_time() - t0;
+	return st;
+}
+//switching thresholds of the direction-optimizing BFS: go bottom-up when
+//the frontier has more than 1/ALPHA of the unexplored edges, go back
+//top-down when it has less than 1/BETA of the nodes
+#define ALPHA 14
+#define BETA 24
+//bitmap helpers, set_bit is atomic since threads share the words
+bool test_bit(unsigned long long bits[], int v){
+	return (bits[v >> 6] >> (v & 63)) & 1;
+}
+//set bit v and return true if it was not set before
+bool set_bit(unsigned long long bits[], int v){
+	unsigned long long mask = 1ULL << (v & 63);
+	if (bits[v >> 6] & mask)
+		return false;
+	return !(__sync_fetch_and_or(&bits[v >> 6], mask) & mask);
+}
+//level-synchronous parallel BFS from start (build with -fopenmp); it fills
+//parent[] for solution(), parent[start] = start and -1 for unreached
+//nodes, and returns the number of reached nodes. Small frontiers are
+//expanded top-down, large ones bottom-up: every unvisited node looks for
+//a parent in the frontier among its in-neighbors, taken from the reverse
+//graph r = csr_reverse(g), so directed graphs are searched correctly
+int bfs_parallel(csr_graph &g, csr_graph &r, int start, int parent[])
+{
+	int words = (g.n + 63) / 64;
+	unsigned long long *visited = (unsigned long long*)calloc(words, sizeof(unsigned long long));
+	unsigned long long *front = (unsigned long long*)calloc(words, sizeof(unsigned long long));
+	unsigned long long *next = (unsigned long long*)calloc(words, sizeof(unsigned long long));
+	//frontier as a list of nodes for the top-down steps
+	int *list = (int*)malloc(g.n * sizeof(int));
+	int *next_list = (int*)malloc(g.n * sizeof(int));
+	#pragma omp parallel for
+	for (int v = 0; v<g.n; v++)
+		parent[v] = -1;
+	parent[start] = start;
+	set_bit(visited,start);
+	list[0] = start;
+	int size = 1, reached = 1;
+	//edges of the frontier and of the unexplored nodes
+	long m_f = g.offset[start+1] - g.offset[start];
+	long m_u = g.m - m_f;
+	bool bottom_up = false;
+	while (size > 0){
+		if (!bottom_up && m_f > m_u / ALPHA){
+			//the list becomes a bitmap
+			bottom_up = true;
+			memset(front, 0, words * sizeof(unsigned long long));
+			for (int i = 0; i<size; i++)
+				front[list[i] >> 6] |= 1ULL << (list[i] & 63);
+		}
+		else if (bottom_up && size < g.n / BETA){
+			//the bitmap becomes a list
+			bottom_up = false;
+			int k = 0;
+			for (int v = 0; v<g.n; v++)
+				if (test_bit(front,v))
+					list[k++] = v;
+		}
+		int next_size = 0;
+		long next_m = 0;
+		if (!bottom_up){
+			//top-down step: the frontier claims its unvisited neighbors
+			#pragma omp parallel for schedule(dynamic,64) reduction(+:next_m)
+			for (int i = 0; i<size; i++){
+				int u = list[i];
+				for (int e = g.offset[u]; e<g.offset[u+1]; e++){
+					int v = g.adj[e];
+					if (set_bit(visited,v)){
+						parent[v] = u;
+						next_list[__sync_fetch_and_add(&next_size,1)] = v;
+						next_m += g.offset[v+1] - g.offset[v];
+					}
+				}
+			}
+			int *t = list;
+			list = next_list;
+			next_list = t;
+		}
+		else{
+			//bottom-up step: every unvisited node searches a parent
+			memset(next, 0, words * sizeof(unsigned long long));
+			#pragma omp parallel for schedule(dynamic,1024) reduction(+:next_size,next_m)
+			for (int v = 0; v<g.n; v++){
+				if (test_bit(visited,v))
+					continue;
+				for (int e = r.offset[v]; e<r.offset[v+1]; e++){
+					if (test_bit(front,r.adj[e])){
+						parent[v] = r.adj[e];
+						__sync_fetch_and_or(&next[v >> 6], 1ULL << (v & 63));
+						next_size++;
+						next_m += g.offset[v+1] - g.offset[v];
+						break;
+					}
+				}
+			}
+			//the new frontier is visited
+			for (int w = 0; w<words; w++)
+				visited[w] |= next[w];
+			unsigned long long *t = front;
+			front = next;
+			next = t;
+		}
+		size = next_size;
+		reached += size;
+		m_f = next_m;
+		m_u -= m_f;
+	}
+	free(visited);
+	free(front);
+	free(next);
+	free(list);
+	free(next_list);
+	return reached;
+}
+//result of a query
+struct query_result{
+	int start, goal;
+	double cost;     //-1 when there is no path
+	int length;      //number of nodes on the path
+	int *path;       //start, ..., goal
+	search_stats st;
+};
+//query engine: a graph and one workspace per thread
+struct query_engine{
+	csr_graph *g;
+	int threads;
+	workspace *w;
+};
+//create a query engine on graph g
+query_engine engine_create(csr_graph &g){
+	query_engine q;
+	q.g = &g;
+#ifdef _OPENMP
+	q.threads = omp_get_max_threads();
+#else
+	q.threads = 1;
+#endif
+	q.w = (workspace*)malloc(q.threads * sizeof(workspace));
+	for (int t = 0; t<q.threads; t++)
+		q.w[t] = workspace_create(g.n);
+	return q;
+}
+//release a query engine
+void engine_free(query_engine &q){
+	for (int t = 0; t<q.threads; t++)
+		workspace_free(q.w[t]);
+	free(q.w);
+}
+//answer a batch of queries (start, goal) on the threads of the engine; a
+//traced build runs on one thread so that the output stays in order
+void engine_run(query_engine &q, int queries[][2], int count, query_result result[]){
+	#pragma omp parallel for schedule(dynamic) if (TRACE == 0)
+	for (int i = 0; i<count; i++){
+#ifdef _OPENMP
+		workspace &w = q.w[omp_get_thread_num()];
+#else
+		workspace &w = q.w[0];
+#endif
+		query_result &r = result[i];
+		r.start = queries[i][0];
+		r.goal = queries[i][1];
+		r.st = bfs(*q.g,w,r.start,r.goal);
+		r.cost = r.st.cost;
+		r.length = 0;
+		r.path = r.cost >= 0 ? take_path(w.parent,r.start,r.goal,r.length) : NULL;
+	}
+}
+//release the paths of a batch
+void result_free(query_result result[], int count){
+	for (int i = 0; i<count; i++){
+		free(result[i].path);
+		result[i].path = NULL;
+	}
+}
+//the main program, "BFS file start goal" searches a graph file
+int main(int argc, char *argv[]){
+	if (argc > 3){
+		csr_graph g;
+		double *x, *y;
+		if (!csr_map(argv[1],g,x,y)){
+			printf("\n cannot load the graph %s\n",argv[1]);
+			return 1;
+		}
+		int start = atoi(argv[2]), goal = atoi(argv[3]);
+		if (start < 0 || start >= g.n || goal < 0 || goal >= g.n){
+			printf("\n no node %d or %d\n",start,goal);
+			csr_free(g);
+			return 1;
+		}
+		workspace w = workspace_create(g.n);
+		search_stats st = bfs(g,w,start,goal);
+		print_stats(st);
+		workspace_free(w);
+		csr_free(g);
+		return 0;
+	}		
 	//an example adjacency matrix 
 	int graph[N][N] = {
         {0, 1, 1, 0, 0, 0},
@@ -126,6 +737,42 @@ int main(){
     	printf("\n");
     }
     */
-	bfs(graph,start,goal);
+	csr_graph g = csr_from_matrix(graph);
+	workspace w = workspace_create(g.n);
+	search_stats st = bfs(g,w,start,goal);
+	print_stats(st);
+	//the same query with the parallel BFS
+	csr_graph r = csr_reverse(g);
+	int *parent = (int*)malloc(g.n * sizeof(int));
+	double t0 = wall_time();
+	int reached = bfs_parallel(g,r,start,parent);
+	printf("\n PARALLEL BFS: reached %d nodes, time %0.3f s",
+		reached, wall_time() - t0);
+	if (parent[goal] >= 0)
+		solution(parent,g.n,start,goal);
+	printf("\n");
+	free(parent);
+	//the same query searched from both ends
+	search_state bs = state_create(g.n);
+	st = bfs_bidirectional(g,r,w.s,bs,start,goal);
+	print_stats(st);
+	state_free(bs);
+	csr_free(r);
+	workspace_free(w);
+	//a batch of queries on the engine
+	int queries[3][2] = {{0, 5}, {3, 2}, {5, 1}};
+	query_result result[3];
+	query_engine q = engine_create(g);
+	engine_run(q,queries,3,result);
+	printf("\n BATCH:");
+	for (int i = 0; i<3; i++){
+		printf("\n %5d -> %5d: cost %0.1f, path",result[i].start,result[i].goal,result[i].cost);
+		for (int k = 0; k<result[i].length; k++)
+			printf("%5d",result[i].path[k]);
+	}
+	printf("\n");
+	result_free(result,3);
+	engine_free(q);
+	csr_free(g);
 	return 0;
 }
@@ -1,103 +1,355 @@
 //programmed by HOANG HUU VIET
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
 #include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 //the number of nodes
 #define N 6
-//display the frontier and explored sets
-void display(int queue[], int k){
-	for (int i = 0; i<k; i++)
-		printf("%5d",queue[i]);
+//trace level: 0 keeps the search silent, 1 prints the solution, 2 also
+//prints the explored and frontier sets at every iteration; the summary is
+//always printed at the end, build with -DTRACE=0 for large graphs
+#ifndef TRACE
+#define TRACE 2
+#endif
+#if TRACE >= 2
+#define trace(...) printf(__VA_ARGS__)
+#else
+#define trace(...) do { } while (0)
+#endif
+//summary of a search
+struct search_stats{
+	long expanded;     //number of expanded nodes
+	int max_frontier;  //largest size of the frontier
+	double cost;       //path cost, -1 when there is no solution
+	double elapsed;    //running time in seconds
+};
+//print the summary of a search
+void print_stats(search_stats &st){
+	printf("\n\n SUMMARY: expanded %ld, max frontier %d, path cost %0.1f, time %0.3f s\n",
+		st.expanded, st.max_frontier, st.cost, st.elapsed);
 }
-//take the top element of the frontier
-int pop(int queue[], int &k){
-	int node = queue[0];
-	for (int i = 0; i<k; i++){
-		queue[i] = queue[i+1];
+//graph in compressed sparse row form: the neighbors of node u are
+//adj[offset[u]], ..., adj[offset[u+1]-1]
+struct csr_graph{
+	int n;          //number of nodes
+	int m;          //number of edges
+	int *offset;    //n+1 entries
+	int *adj;       //m entries
+	double *weight; //m entries, NULL for an unweighted graph
+	char *map;      //file mapping of a loaded graph, NULL when allocated
+	size_t map_size;
+};
+//build a csr graph from an adjacency matrix
+csr_graph csr_from_matrix(int graph[][N]){
+	csr_graph g;
+	g.n = N;
+	g.m = 0;
+	for (int i = 0; i<N; i++)
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] == 1)
+				g.m++;
+	g.map = NULL;
+	g.map_size = 0;
+	g.offset = (int*)malloc((g.n + 1) * sizeof(int));
+	g.adj = (int*)malloc((g.m > 0 ? g.m : 1) * sizeof(int));
+	g.weight = NULL;
+	int k = 0;
+	for (int i = 0; i<N; i++){
+		g.offset[i] = k;
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] == 1)
+				g.adj[k++] = j;
 	}
-	k = k-1;
-	return node;
+	g.offset[N] = k;
+	return g;
 }
-//insert an element to the lifo queue
-void insert(int queue[], int &k, int node){
-	if (k == 0){
-		queue[0] = node;
+//binary graph file written by graph_converter: a header, offset[n+1] and
+//adj[m] as 32-bit integers, then weight[m] and the coordinates x[n], y[n]
+//as doubles when the flags say so; the doubles start at a multiple of 8
+#define GRAPH_MAGIC 0x47525343
+#define HAS_WEIGHTS 1
+#define HAS_COORDS  2
+struct graph_header{
+	int magic;     //"CSRG"
+	int version;   //1
+	int n, m;
+	int flags;
+	int reserved[3];
+};
+//unmap a file mapping
+void unmap(char *base, size_t size){
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+//map a binary graph file into memory: the arrays of g and the coordinates
+//x, y (NULL when absent) point into the mapping and pages are read on
+//first use, so loading does not depend on the size of the graph
+bool csr_map(const char *file, csr_graph &g, double *&x, double *&y){
+	char *base = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(f, &length) && length.QuadPart > 0){
+		size = (size_t)length.QuadPart;
+		HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL){
+			base = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(f);
+#else
+	int fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0){
+		size = (size_t)sb.st_size;
+		base = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (base == (char*)MAP_FAILED)
+			base = NULL;
+	}
+	close(fd);
+#endif
+	if (base == NULL)
+		return false;
+	graph_header *h = (graph_header*)base;
+	bool ok = size >= sizeof(graph_header) && h->magic == GRAPH_MAGIC && h->version == 1
+		&& h->n >= 0 && h->m >= 0;
+	size_t doubles = (sizeof(graph_header) + ((size_t)h->n + 1 + h->m) * sizeof(int) + 7) & ~(size_t)7;
+	size_t need = doubles;
+	if (h->flags & HAS_WEIGHTS)
+		need += (size_t)h->m * sizeof(double);
+	if (h->flags & HAS_COORDS)
+		need += 2 * (size_t)h->n * sizeof(double);
+	if (!ok || size < need){
+		unmap(base, size);
+		return false;
 	}
+	g.n = h->n;
+	g.m = h->m;
+	g.offset = (int*)(base + sizeof(graph_header));
+	g.adj = g.offset + g.n + 1;
+	g.weight = (h->flags & HAS_WEIGHTS) ? (double*)(base + doubles) : NULL;
+	x = y = NULL;
+	if (h->flags & HAS_COORDS){
+		x = (double*)(base + doubles) + ((h->flags & HAS_WEIGHTS) ? g.m : 0);
+		y = x + g.n;
+	}
+	g.map = base;
+	g.map_size = size;
+	return true;
+}
+//release a csr graph
+void csr_free(csr_graph &g){
+	if (g.map != NULL)
+		unmap(g.map, g.map_size);
 	else{
-		for (int i = k; i>0; i--){
-			queue[i] = queue[i-1];
-		}
-		queue[0] = node;
+		free(g.offset);
+		free(g.adj);
+		free(g.weight);
 	}
-	k = k+1;
+	g.map = NULL;
+	g.offset = g.adj = NULL;
+	g.weight = NULL;
+	g.n = g.m = 0;
 }
-//check an element in the frontier and explored sets
-bool exist(int queue[], int k, int node){
-	for (int i = 0; i<k; i++){
-		if (queue[i] == node){
-			return true;
-		}
+//lifo queue on an array, the top is the last element
+struct lifo{
+	int size;
+	int *node;
+};
+//create an empty lifo queue
+lifo lifo_create(int capacity){
+	lifo q;
+	q.size = 0;
+	q.node = (int*)malloc(capacity * sizeof(int));
+	return q;
+}
+//release a lifo queue
+void lifo_free(lifo &q){
+	free(q.node);
+	q.node = NULL;
+}
+//display the frontier and explored sets from the top
+void display(lifo &q){
+	for (int i = q.size-1; i>=0; i--)
+		printf("%5d",q.node[i]);
+}
+//take the top element of the frontier
+int pop(lifo &q){
+	q.size = q.size-1;
+	return q.node[q.size];
+}
+//insert an element to the lifo queue
+void insert(lifo &q, int node){
+	q.node[q.size] = node;
+	q.size = q.size+1;
+}
+//states of a node during a search
+#define UNSEEN   0
+#define FRONTIER 1
+#define CLOSED   2
+//per-node search state packed in one word: the search generation in the
+//high bits and the state in the low two bits; a node stamped with an older
+//generation is UNSEEN, so a new search does not clear the array
+struct search_state{
+	int n;
+	unsigned int generation;
+	unsigned int *word;
+};
+//create the search state for n nodes
+search_state state_create(int n){
+	search_state s;
+	s.n = n;
+	s.generation = 0;
+	s.word = (unsigned int*)calloc(n, sizeof(unsigned int));
+	return s;
+}
+//release the search state
+void state_free(search_state &s){
+	free(s.word);
+	s.word = NULL;
+}
+//start a new search, every node becomes UNSEEN
+void state_reset(search_state &s){
+	s.generation = (s.generation + 1) & 0x3FFFFFFF;
+	if (s.generation == 0){
+		//the generation wrapped around, clear the old stamps once
+		memset(s.word, 0, s.n * sizeof(unsigned int));
+		s.generation = 1;
 	}
-	return false;
 }
-//print solution
-void solution(int parent[], int start, int goal)
+//take the state of node v
+int state_get(search_state &s, int v){
+	unsigned int w = s.word[v];
+	return (w >> 2) == s.generation ? (int)(w & 3) : UNSEEN;
+}
+//set the state of node v
+void state_set(search_state &s, int v, int state){
+	s.word[v] = (s.generation << 2) | state;
+}
+//print solution and return the number of edges on the path
+int solution(int parent[], int n, int start, int goal)
 {
-	int path[N];
+	int *path = (int*)malloc(n * sizeof(int));
 	int k = 0;
 	path[k++] = goal;
 	int node = goal;
-	while (parent[node] != start){
+	while (node != start){
 		node = parent[node];
 		path[k++] = node;
 	}
-	path[k++] = start; 
+#if TRACE >= 1
 	printf("\n\n SOLUTION:");
 	for (int i = k-1; i>=0; i--){
 		printf("%5d",path[i]);
-	}	
+	}
+#endif
+	free(path);
+	return k-1;
 }
 
 //DFS algorithm
-void dfs(int graph[][N], int start, int goal)
+search_stats dfs(csr_graph &g, search_state &s, int start, int goal)
 {
-	int frontier[N] = {0}, explored[N] = {0}, parent[N] = {0};
-	//sizes of frontier and explores
-	int n = 0, m = 0;
+	//every node enters the frontier and explored sets at most once
+	lifo frontier = lifo_create(g.n), explored = lifo_create(g.n);
+	int *parent = (int*)calloc(g.n, sizeof(int));
+	search_stats st = {0, 1, -1, 0};
+	clock_t t0 = clock();
 	int node = start;
 	parent[node] = node;
 	
-	insert(frontier,n,node);	
+	state_reset(s);
+	state_set(s,node,FRONTIER);
+	insert(frontier,node);	
+	//the goal is only tested on generated children, so test the start here
+	if (start == goal)
+		st.cost = solution(parent,g.n,start,goal);
 	int iter = 1;
-	while (true){
+	while (st.cost < 0 && frontier.size > 0){
 		
-		printf("\n\n -------- iteration %d -----------",iter);
-		node = pop(frontier,n);		
-		insert(explored,m,node);
+		trace("\n\n -------- iteration %d -----------",iter);
+		node = pop(frontier);		
+		state_set(s,node,CLOSED);
+		insert(explored,node);
+		st.expanded++;
 				
-		printf("\n node: %5d ->",node);		
-		for (int j = 0; j<N; j++){
-			if (graph[node][j] == 1){
-				int child = j;
-				if (!(exist(explored,m,child)||exist(frontier,n,child))){
-					parent[child] = node;
-					printf("%5d",child);
-					if (child == goal){						
-						solution(parent,start,goal);
-						return;
-					}
-					insert(frontier,n,child);
+		trace("\n node: %5d ->",node);		
+		//only the neighbors of node are visited
+		for (int e = g.offset[node]; e<g.offset[node+1]; e++){
+			int child = g.adj[e];
+			if (state_get(s,child) == UNSEEN){
+				parent[child] = node;
+				trace("%5d",child);
+				if (child == goal){						
+					st.cost = solution(parent,g.n,start,goal);
+					break;
 				}
+				state_set(s,child,FRONTIER);
+				insert(frontier,child);
+				if (frontier.size > st.max_frontier)
+					st.max_frontier = frontier.size;
 			}
 		}
+		if (st.cost >= 0)
+			break;
+#if TRACE >= 2
 		printf("\n explored set:");
-		display(explored,m);		
+		display(explored);		
 		printf("\n frontier set:");
-		display(frontier,n);		
+		display(frontier);
+#endif
 	    iter++;
 	}
+#if TRACE >= 1
+	if (st.cost < 0)
+		printf("\n\n There exists no solution.");
+#endif
+	lifo_free(frontier);
+	lifo_free(explored);
+	free(parent);
+	st.elapsed = (double)(clock() - t0) / CLOCKS_PER_SEC;
+	return st;
 }
-//the main program
-int main(){	
+//the main program, "DFS file start goal" searches a graph file
+int main(int argc, char *argv[]){
+	if (argc > 3){
+		csr_graph g;
+		double *x, *y;
+		if (!csr_map(argv[1],g,x,y)){
+			printf("\n cannot load the graph %s\n",argv[1]);
+			return 1;
+		}
+		int start = atoi(argv[2]), goal = atoi(argv[3]);
+		if (start < 0 || start >= g.n || goal < 0 || goal >= g.n){
+			printf("\n no node %d or %d\n",start,goal);
+			csr_free(g);
+			return 1;
+		}
+		search_state s = state_create(g.n);
+		search_stats st = dfs(g,s,start,goal);
+		print_stats(st);
+		state_free(s);
+		csr_free(g);
+		return 0;
+	}	
 	//an example adjacency matrix 
 	int graph[N][N] = {
         {0, 1, 1, 0, 0, 0},
@@ -109,6 +361,11 @@ int main(){
     };  
 	int start =0;
 	int goal = 5;
-	dfs(graph,start,goal);
+	csr_graph g = csr_from_matrix(graph);
+	search_state s = state_create(g.n);
+	search_stats st = dfs(g,s,start,goal);
+	print_stats(st);
+	state_free(s);
+	csr_free(g);
 	return 0;
 }
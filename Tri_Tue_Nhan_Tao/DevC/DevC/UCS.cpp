@@ -1,9 +1,274 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
 #include <conio.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 //the number of vertices
 
 #define N 6
 #define str "ABCDEFGHIJK"
+//trace level: 0 keeps the search silent, 1 prints the solution, 2 also
+//prints the explored and frontier sets at every iteration; the summary is
+//always printed at the end, build with -DTRACE=0 for large graphs
+#ifndef TRACE
+#define TRACE 2
+#endif
+#if TRACE >= 2
+#define trace(...) printf(__VA_ARGS__)
+#else
+#define trace(...) do { } while (0)
+#endif
+//summary of a search
+struct search_stats{
+	long expanded;     //number of expanded vertices
+	int max_frontier;  //largest size of the frontier
+	double cost;       //path cost, -1 when there is no solution
+	double elapsed;    //running time in seconds
+};
+//print the summary of a search
+void print_stats(search_stats &st){
+	printf("\n\n SUMMARY: expanded %ld, max frontier %d, path cost %0.1f, time %0.3f s\n",
+		st.expanded, st.max_frontier, st.cost, st.elapsed);
+}
+//wall-clock time in seconds: clock() adds up the processor time of all
+//threads, so it cannot time one query of a parallel batch; without OpenMP
+//there is one thread and clock() is enough
+double wall_time(){
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+//the name of vertex v: a letter of str for the first vertices, else its number
+const char *name(int v){
+	static char buf[16];
+	if (v < (int)sizeof(str) - 1){
+		buf[0] = str[v];
+		buf[1] = 0;
+	}
+	else
+		sprintf(buf,"%d",v);
+	return buf;
+}
+//graph in compressed sparse row form: the neighbors of vertex u are
+//adj[offset[u]], ..., adj[offset[u+1]-1] with the costs weight[...]
+struct csr_graph{
+	int n;          //number of vertices
+	int m;          //number of edges
+	int *offset;    //n+1 entries
+	int *adj;       //m entries
+	double *weight; //m entries, NULL for an unweighted graph
+	char *map;      //file mapping of a loaded graph, NULL when allocated
+	size_t map_size;
+};
+//build a csr graph from a cost matrix, a positive entry is an edge
+csr_graph csr_from_matrix(int graph[][N]){
+	csr_graph g;
+	g.n = N;
+	g.m = 0;
+	for (int i = 0; i<N; i++)
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] > 0)
+				g.m++;
+	g.map = NULL;
+	g.map_size = 0;
+	g.offset = (int*)malloc((g.n + 1) * sizeof(int));
+	g.adj = (int*)malloc((g.m > 0 ? g.m : 1) * sizeof(int));
+	g.weight = (double*)malloc((g.m > 0 ? g.m : 1) * sizeof(double));
+	int k = 0;
+	for (int i = 0; i<N; i++){
+		g.offset[i] = k;
+		for (int j = 0; j<N; j++)
+			if (graph[i][j] > 0){
+				g.adj[k] = j;
+				g.weight[k] = graph[i][j];
+				k++;
+			}
+	}
+	g.offset[N] = k;
+	return g;
+}
+//binary graph file written by graph_converter: a header, offset[n+1] and
+//adj[m] as 32-bit integers, then weight[m] and the coordinates x[n], y[n]
+//as doubles when the flags say so; the doubles start at a multiple of 8
+#define GRAPH_MAGIC 0x47525343
+#define HAS_WEIGHTS 1
+#define HAS_COORDS  2
+struct graph_header{
+	int magic;     //"CSRG"
+	int version;   //1
+	int n, m;
+	int flags;
+	int reserved[3];
+};
+//unmap a file mapping
+void unmap(char *base, size_t size){
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+//map a binary graph file into memory: the arrays of g and the coordinates
+//x, y (NULL when absent) point into the mapping and pages are read on
+//first use, so loading does not depend on the size of the graph
+bool csr_map(const char *file, csr_graph &g, double *&x, double *&y){
+	char *base = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(f, &length) && length.QuadPart > 0){
+		size = (size_t)length.QuadPart;
+		HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL){
+			base = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(f);
+#else
+	int fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size > 0){
+		size = (size_t)sb.st_size;
+		base = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (base == (char*)MAP_FAILED)
+			base = NULL;
+	}
+	close(fd);
+#endif
+	if (base == NULL)
+		return false;
+	graph_header *h = (graph_header*)base;
+	bool ok = size >= sizeof(graph_header) && h->magic == GRAPH_MAGIC && h->version == 1
+		&& h->n >= 0 && h->m >= 0;
+	size_t doubles = (sizeof(graph_header) + ((size_t)h->n + 1 + h->m) * sizeof(int) + 7) & ~(size_t)7;
+	size_t need = doubles;
+	if (h->flags & HAS_WEIGHTS)
+		need += (size_t)h->m * sizeof(double);
+	if (h->flags & HAS_COORDS)
+		need += 2 * (size_t)h->n * sizeof(double);
+	if (!ok || size < need){
+		unmap(base, size);
+		return false;
+	}
+	g.n = h->n;
+	g.m = h->m;
+	g.offset = (int*)(base + sizeof(graph_header));
+	g.adj = g.offset + g.n + 1;
+	g.weight = (h->flags & HAS_WEIGHTS) ? (double*)(base + doubles) : NULL;
+	x = y = NULL;
+	if (h->flags & HAS_COORDS){
+		x = (double*)(base + doubles) + ((h->flags & HAS_WEIGHTS) ? g.m : 0);
+		y = x + g.n;
+	}
+	g.map = base;
+	g.map_size = size;
+	return true;
+}
+//release a csr graph
+void csr_free(csr_graph &g){
+	if (g.map != NULL)
+		unmap(g.map, g.map_size);
+	else{
+		free(g.offset);
+		free(g.adj);
+		free(g.weight);
+	}
+	g.map = NULL;
+	g.offset = g.adj = NULL;
+	g.weight = NULL;
+	g.n = g.m = 0;
+}
+//build the reverse graph, u -> v becomes v -> u
+csr_graph csr_reverse(csr_graph &g){
+	csr_graph r;
+	r.n = g.n;
+	r.m = g.m;
+	r.map = NULL;
+	r.map_size = 0;
+	r.offset = (int*)calloc(r.n + 1, sizeof(int));
+	r.adj = (int*)malloc((r.m > 0 ? r.m : 1) * sizeof(int));
+	r.weight = g.weight != NULL ? (double*)malloc((r.m > 0 ? r.m : 1) * sizeof(double)) : NULL;
+	//count the in-degrees, then place every edge after its target
+	for (int e = 0; e<g.m; e++)
+		r.offset[g.adj[e] + 1]++;
+	for (int v = 0; v<r.n; v++)
+		r.offset[v + 1] += r.offset[v];
+	int *next = (int*)malloc((r.n > 0 ? r.n : 1) * sizeof(int));
+	memcpy(next, r.offset, r.n * sizeof(int));
+	for (int u = 0; u<g.n; u++){
+		for (int e = g.offset[u]; e<g.offset[u+1]; e++){
+			int k = next[g.adj[e]]++;
+			r.adj[k] = u;
+			if (r.weight != NULL)
+				r.weight[k] = g.weight[e];
+		}
+	}
+	free(next);
+	return r;
+}
+//states of a vertex during a search
+#define UNSEEN   0
+#define FRONTIER 1
+#define CLOSED   2
+//per-vertex search state packed in one word: the search generation in the
+//high bits and the state in the low two bits; a vertex stamped with an older
+//generation is UNSEEN, so a new search does not clear the array
+struct search_state{
+	int n;
+	unsigned int generation;
+	unsigned int *word;
+};
+//create the search state for n vertexs
+search_state state_create(int n){
+	search_state s;
+	s.n = n;
+	s.generation = 0;
+	s.word = (unsigned int*)calloc(n, sizeof(unsigned int));
+	return s;
+}
+//release the search state
+void state_free(search_state &s){
+	free(s.word);
+	s.word = NULL;
+}
+//start a new search, every vertex becomes UNSEEN
+void state_reset(search_state &s){
+	s.generation = (s.generation + 1) & 0x3FFFFFFF;
+	if (s.generation == 0){
+		//the generation wrapped around, clear the old stamps once
+		memset(s.word, 0, s.n * sizeof(unsigned int));
+		s.generation = 1;
+	}
+}
+//take the state of vertex v
+int state_get(search_state &s, int v){
+	unsigned int w = s.word[v];
+	return (w >> 2) == s.generation ? (int)(w & 3) : UNSEEN;
+}
+//set the state of vertex v
+void state_set(search_state &s, int v, int state){
+	s.word[v] = (s.generation << 2) | state;
+}
 //struct for a state
 struct vertex{
 	int n;
@@ -12,120 +277,454 @@ struct vertex{
 //display a queue
 void display(vertex queue[], int k){
 	for (int i = 0; i<k; i++)
-		printf("(%c,%0.1f),",str[queue[i].n],queue[i].g);
-}
-//take a node of the minimum g in a queue
-vertex pop(vertex queue[], int &k){
-	vertex node = queue[0];
-	int idx = 0;
-	for (int i = 1; i<k; i++){
-		if (node.g > queue[i].g){
-			node = queue[i];
-			idx = i;
-		}	
-	}
-	for (int i = idx; i<k; i++){
-		queue[i] = queue[i+1];
-	}
-	k = k - 1;
-	return node;
+		printf("(%s,%0.1f),",name(queue[i].n),queue[i].g);
 }
 //insert an element to a queue
 void insert(vertex queue[], int &k, vertex node){
 	queue[k] = node;
 	k = k + 1;	
 }
-//check an element in the queue
-bool exist(vertex queue[], int k, vertex node){
-	for (int i = 0; i<k; i++){
-		if (queue[i].n == node.n){
-			return true;
+//the number of children of a node in the frontier heap
+#define D 4
+//frontier as an indexed d-ary min-heap: slots are ordered by g and, for
+//equal g, by insertion order as in a linear frontier; pos[v] is the slot
+//of vertex v while v is in the FRONTIER state
+struct heap{
+	int size;
+	long next;     //insertion counter
+	vertex *node;  //slot -> vertex
+	long *order;   //slot -> insertion order
+	int *pos;      //vertex -> slot
+};
+//create an empty heap for n vertices
+heap heap_create(int n){
+	heap h;
+	h.size = 0;
+	h.next = 0;
+	h.node = (vertex*)malloc(n * sizeof(vertex));
+	h.order = (long*)malloc(n * sizeof(long));
+	h.pos = (int*)malloc(n * sizeof(int));
+	return h;
+}
+//release a heap
+void heap_free(heap &h){
+	free(h.node);
+	free(h.order);
+	free(h.pos);
+}
+//compare two slots of the heap
+bool heap_less(heap &h, int a, int b){
+	if (h.node[a].g != h.node[b].g)
+		return h.node[a].g < h.node[b].g;
+	return h.order[a] < h.order[b];
+}
+//exchange two slots of the heap
+void heap_swap(heap &h, int a, int b){
+	vertex node = h.node[a];
+	h.node[a] = h.node[b];
+	h.node[b] = node;
+	long order = h.order[a];
+	h.order[a] = h.order[b];
+	h.order[b] = order;
+	h.pos[h.node[a].n] = a;
+	h.pos[h.node[b].n] = b;
+}
+//move slot i towards the root
+void sift_up(heap &h, int i){
+	while (i > 0){
+		int p = (i - 1) / D;
+		if (!heap_less(h,i,p))
+			break;
+		heap_swap(h,i,p);
+		i = p;
+	}
+}
+//move slot i towards the leaves
+void sift_down(heap &h, int i){
+	while (true){
+		int best = i;
+		int first = D * i + 1;
+		for (int c = first; c < first + D && c < h.size; c++){
+			if (heap_less(h,c,best))
+				best = c;
 		}
+		if (best == i)
+			break;
+		heap_swap(h,i,best);
+		i = best;
+	}
+}
+//take a node of the minimum g in the frontier
+vertex pop(heap &h){
+	vertex node = h.node[0];
+	h.size = h.size - 1;
+	if (h.size > 0){
+		h.node[0] = h.node[h.size];
+		h.order[0] = h.order[h.size];
+		h.pos[h.node[0].n] = 0;
+		sift_down(h,0);
 	}
-	return false;
+	return node;
+}
+//insert an element to the frontier
+void insert(heap &h, vertex node){
+	int i = h.size;
+	h.size = h.size + 1;
+	h.node[i] = node;
+	h.order[i] = h.next++;
+	h.pos[node.n] = i;
+	sift_up(h,i);
+}
+//lower the g of vertex v in the frontier
+void decrease(heap &h, int v, double g){
+	int i = h.pos[v];
+	h.node[i].g = g;
+	sift_up(h,i);
+}
+//take the next block of an arena, blocks are aligned to 16 bytes
+void *carve(char *&p, size_t bytes){
+	void *block = p;
+	p += (bytes + 15) & ~(size_t)15;
+	return block;
+}
+//workspace of a search: the search state, the frontier heap, the explored
+//set and the parent array, carved out of one arena block; a thread keeps
+//its workspace for all of its queries and the search state resets by
+//generation, so a query does not allocate or clear anything
+struct workspace{
+	char *arena;
+	search_state s;
+	heap frontier;
+	vertex *explored;
+	int *parent;
+};
+//create a workspace for n vertices
+workspace workspace_create(int n){
+	workspace w;
+	size_t bytes = 2 * n * sizeof(vertex) + n * sizeof(long) + 3 * n * sizeof(int) + 6 * 16;
+	w.arena = (char*)malloc(bytes);
+	char *p = w.arena;
+	w.frontier.node = (vertex*)carve(p, n * sizeof(vertex));
+	w.explored = (vertex*)carve(p, n * sizeof(vertex));
+	w.frontier.order = (long*)carve(p, n * sizeof(long));
+	w.frontier.pos = (int*)carve(p, n * sizeof(int));
+	w.parent = (int*)carve(p, n * sizeof(int));
+	w.s.n = n;
+	w.s.generation = 0;
+	w.s.word = (unsigned int*)carve(p, n * sizeof(unsigned int));
+	memset(w.s.word, 0, n * sizeof(unsigned int));
+	return w;
+}
+//release a workspace
+void workspace_free(workspace &w){
+	free(w.arena);
+	w.arena = NULL;
+}
+//take the path start -> goal from parent[], its number of vertices is k
+int *take_path(int parent[], int start, int goal, int &k)
+{
+	k = 1;
+	for (int node = goal; node != start; node = parent[node])
+		k++;
+	int *path = (int*)malloc(k * sizeof(int));
+	int i = k;
+	for (int node = goal; node != start; node = parent[node])
+		path[--i] = node;
+	path[0] = start;
+	return path;
 }
 //take the solution
-void solution(int parent[], vertex start, vertex goal){
-	int path[N];
+void solution(int parent[], int n, vertex start, vertex goal){
+	int *path = (int*)malloc(n * sizeof(int));
 	int k = 0, node = goal.n;
 	path[k++] = goal.n;
 	while (node != start.n){
 		node = parent[node];
 		path[k++] = node;
 	}
+#if TRACE >= 1
 	printf("\n\n SOLUTION:");
 	for (int i = k-1; i>=0; i--){
-		printf("%c->",str[path[i]]);
+		printf("%s->",name(path[i]));
 	}
+#endif
+	free(path);
 }
 
 //UCS algorithm
-void UCS(int graph[][N], vertex start, vertex goal){	
+search_stats UCS(csr_graph &g, workspace &w, vertex start, vertex goal){	
     //struct for frontier, explored and parent
-	vertex frontier[N], explored[N];
-	//sizes of frontier and explores
-	int size_frontier = 0, size_explored = 0;
+	heap &frontier = w.frontier;
+	frontier.size = 0;
+	frontier.next = 0;
+	vertex *explored = w.explored;
+	//size of explores
+	int size_explored = 0;
+	search_state &s = w.s;
 	
-	int parent[N];
+	int *parent = w.parent;
     parent[start.n] = start.n;
+	search_stats st = {0, 1, -1, 0};
+	double t0 = wall_time();
    
-    insert(frontier,size_frontier,start);
+    state_reset(s);
+    state_set(s,start.n,FRONTIER);
+    insert(frontier,start);
 	int iter = 1;
-	while (true){
-		printf("\n\n -------- iteration %d -----------",iter);
-		vertex node = pop(frontier,size_frontier);		
+	while (frontier.size > 0){
+		trace("\n\n -------- iteration %d -----------",iter);
+		vertex node = pop(frontier);		
 		//check goal
 		if (node.n == goal.n){
-			//printf("\n take vertex %c -> stop.",str[node.n]);
-			solution(parent,start,goal);
+			//printf("\n take vertex %s -> stop.",name(node.n));
+			solution(parent,g.n,start,goal);
+#if TRACE >= 1
 			printf("\n PATH -COST: %0.1f",node.g);
-			return;
+#endif
+			st.cost = node.g;
+			break;
 		}
+		state_set(s,node.n,CLOSED);
 		insert(explored,size_explored,node);
-		printf("\n take vertex: %c ->",str[node.n]);		
-		for (int j = 0; j<N; j++){
-			if (graph[node.n][j] > 0){
-				vertex child;
-				child.n = j;				
-				if (!(exist(explored,size_explored,child)||exist(frontier,size_frontier,child))){
-					parent[child.n] = node.n;					
-					child.g = node.g + graph[node.n][j];
-					insert(frontier,size_frontier,child);					
-					printf("%c, ",str[child.n]);
-				}			
-				else{				
-					if (exist(frontier,size_frontier,child)){
-						//find the index of child in the frontier
-						int idx = 0;
-						for (int i = 0; i < size_frontier; i++){
-							if (frontier[i].n == child.n){
-								idx = i;
-								break;
-							}
-						}
-						//update the lower cost in the frontier
-						if (frontier[idx].g > node.g + graph[node.n][j]){
-							parent[child.n] = node.n;
-							frontier[idx].g = node.g + graph[node.n][j];
-							printf("%c, ",str[child.n]);
-						}
-						else{
-							printf("|");
-						}
-												
+		st.expanded++;
+		trace("\n take vertex: %s ->",name(node.n));		
+		//only the neighbors of node are visited
+		for (int e = g.offset[node.n]; e<g.offset[node.n+1]; e++){
+			int j = g.adj[e];
+			double cost = g.weight[e];
+			vertex child;
+			child.n = j;				
+			if (state_get(s,child.n) == UNSEEN){
+				parent[child.n] = node.n;					
+				child.g = node.g + cost;
+				state_set(s,child.n,FRONTIER);
+				insert(frontier,child);					
+				if (frontier.size > st.max_frontier)
+					st.max_frontier = frontier.size;
+				trace("%s, ",name(child.n));
+			}			
+			else{				
+				if (state_get(s,child.n) == FRONTIER){
+					//the slot of child in the frontier
+					int idx = frontier.pos[child.n];
+					//update the lower cost in the frontier
+					if (frontier.node[idx].g > node.g + cost){
+						parent[child.n] = node.n;
+						decrease(frontier,child.n,node.g + cost);
+						trace("%s, ",name(child.n));
+					}
+					else{
+						trace("|");
 					}
+											
 				}
 			}
 		}
+#if TRACE >= 2
 		printf("\n explored set:");
 		display(explored,size_explored);		
 		printf("\n frontier set:");
-		display(frontier,size_frontier);				
+		display(frontier.node,frontier.size);				
+#endif
+	    iter++;
+	}
+#if TRACE >= 1
+	if (st.cost < 0)
+		printf("\n\n There exists no solution.");
+#endif
+	st.elapsed = wall_time() - t0;
+	return st;
+}
+//settle the top vertex of one side of a bidirectional UCS: its neighbors
+//in g are relaxed, and a vertex reached by both sides may lower the best
+//path cost mu through meet
+void expand_side(csr_graph &g, heap &frontier, search_state &s, double d[], int parent[],
+	search_state &other, double other_d[], double &mu, int &meet, search_stats &st)
+{
+	vertex node = pop(frontier);
+	state_set(s,node.n,CLOSED);
+	st.expanded++;
+	trace("\n take vertex: %s ->",name(node.n));
+	for (int e = g.offset[node.n]; e<g.offset[node.n+1]; e++){
+		int j = g.adj[e];
+		double cost = node.g + g.weight[e];
+		int state = state_get(s,j);
+		if (state == CLOSED)
+			continue;
+		if (state == UNSEEN){
+			vertex child = {j, cost};
+			d[j] = cost;
+			parent[j] = node.n;
+			state_set(s,j,FRONTIER);
+			insert(frontier,child);
+			trace("%s, ",name(j));
+		}
+		else if (d[j] > cost){
+			d[j] = cost;
+			parent[j] = node.n;
+			decrease(frontier,j,cost);
+			trace("%s, ",name(j));
+		}
+		//a path start -> ... -> j -> ... -> goal
+		if (state_get(other,j) != UNSEEN && d[j] + other_d[j] < mu){
+			mu = d[j] + other_d[j];
+			meet = j;
+		}
+	}
+}
+//bidirectional UCS: a forward search from start on g and a backward search
+//from goal on the reverse graph r, each step settles the side with the
+//smaller top cost; once the two top costs add up to the best path cost mu
+//found so far, no shorter path exists
+search_stats UCS_bidirectional(csr_graph &g, csr_graph &r, search_state &fs, search_state &bs,
+	vertex start, vertex goal)
+{
+	heap forward = heap_create(g.n), backward = heap_create(g.n);
+	double *df = (double*)malloc(g.n * sizeof(double));
+	double *db = (double*)malloc(g.n * sizeof(double));
+	int *parent = (int*)malloc(g.n * sizeof(int));
+	int *parent_b = (int*)malloc(g.n * sizeof(int));
+	search_stats st = {0, 2, -1, 0};
+	double t0 = wall_time();
+	vertex first = {start.n, 0}, last = {goal.n, 0};
+	parent[start.n] = start.n;
+	parent_b[goal.n] = goal.n;
+	df[start.n] = 0;
+	db[goal.n] = 0;
+	state_reset(fs);
+	state_reset(bs);
+	state_set(fs,start.n,FRONTIER);
+	state_set(bs,goal.n,FRONTIER);
+	insert(forward,first);
+	insert(backward,last);
+	double mu = start.n == goal.n ? 0 : INFINITY;
+	int meet = start.n == goal.n ? start.n : -1;
+	int iter = 1;
+	while (forward.size > 0 && backward.size > 0
+		&& forward.node[0].g + backward.node[0].g < mu){
+		trace("\n\n -------- iteration %d -----------",iter);
+		if (forward.node[0].g <= backward.node[0].g){
+			trace("\n forward");
+			expand_side(g,forward,fs,df,parent,bs,db,mu,meet,st);
+		}
+		else{
+			trace("\n backward");
+			expand_side(r,backward,bs,db,parent_b,fs,df,mu,meet,st);
+		}
+		if (forward.size + backward.size > st.max_frontier)
+			st.max_frontier = forward.size + backward.size;
 	    iter++;
 	}
+	if (meet >= 0){
+		//stitch the backward chain from meet to goal onto the forward one
+		int node = meet;
+		while (node != goal.n){
+			int next = parent_b[node];
+			parent[next] = node;
+			node = next;
+		}
+		solution(parent,g.n,start,goal);
+#if TRACE >= 1
+		printf("\n PATH -COST: %0.1f",mu);
+#endif
+		st.cost = mu;
+	}
+#if TRACE >= 1
+	else
+		printf("\n\n There exists no solution.");
+#endif
+	heap_free(forward);
+	heap_free(backward);
+	free(df);
+	free(db);
+	free(parent);
+	free(parent_b);
+	st.elapsed = wall_time() - t0;
+	return st;
+}
+//result of a query
+struct query_result{
+	int start, goal;
+	double cost;     //-1 when there is no path
+	int length;      //number of vertices on the path
+	int *path;       //start, ..., goal
+	search_stats st;
+};
+//query engine: a graph and one workspace per thread
+struct query_engine{
+	csr_graph *g;
+	int threads;
+	workspace *w;
+};
+//create a query engine on graph g
+query_engine engine_create(csr_graph &g){
+	query_engine q;
+	q.g = &g;
+#ifdef _OPENMP
+	q.threads = omp_get_max_threads();
+#else
+	q.threads = 1;
+#endif
+	q.w = (workspace*)malloc(q.threads * sizeof(workspace));
+	for (int t = 0; t<q.threads; t++)
+		q.w[t] = workspace_create(g.n);
+	return q;
 }
-//main
-int main(){
+//release a query engine
+void engine_free(query_engine &q){
+	for (int t = 0; t<q.threads; t++)
+		workspace_free(q.w[t]);
+	free(q.w);
+}
+//answer a batch of queries (start, goal) on the threads of the engine; a
+//traced build runs on one thread so that the output stays in order
+void engine_run(query_engine &q, int queries[][2], int count, query_result result[]){
+	#pragma omp parallel for schedule(dynamic) if (TRACE == 0)
+	for (int i = 0; i<count; i++){
+#ifdef _OPENMP
+		workspace &w = q.w[omp_get_thread_num()];
+#else
+		workspace &w = q.w[0];
+#endif
+		query_result &r = result[i];
+		r.start = queries[i][0];
+		r.goal = queries[i][1];
+		vertex start = {r.start, 0}, goal = {r.goal, 0};
+		r.st = UCS(*q.g,w,start,goal);
+		r.cost = r.st.cost;
+		r.length = 0;
+		r.path = r.cost >= 0 ? take_path(w.parent,r.start,r.goal,r.length) : NULL;
+	}
+}
+//release the paths of a batch
+void result_free(query_result result[], int count){
+	for (int i = 0; i<count; i++){
+		free(result[i].path);
+		result[i].path = NULL;
+	}
+}
+//main, "UCS file start goal" searches a graph file
+int main(int argc, char *argv[]){
+	if (argc > 3){
+		csr_graph g;
+		double *x, *y;
+		if (!csr_map(argv[1],g,x,y) || g.weight == NULL){
+			printf("\n cannot load the weighted graph %s\n",argv[1]);
+			return 1;
+		}
+		vertex start = {atoi(argv[2]), 0}, goal = {atoi(argv[3]), 0};
+		if (start.n < 0 || start.n >= g.n || goal.n < 0 || goal.n >= g.n){
+			printf("\n no vertex %d or %d\n",start.n,goal.n);
+			csr_free(g);
+			return 1;
+		}
+		workspace w = workspace_create(g.n);
+		search_stats st = UCS(g,w,start,goal);
+		print_stats(st);
+		workspace_free(w);
+		csr_free(g);
+		return 0;
+	}
 	int graph[N][N] = {
         {0, 2, 7, 0, 0, 0},
         {2, 0, 0, 3, 1, 0},
@@ -137,6 +736,33 @@ int main(){
 	vertex start = {0,0}; 
 	vertex goal = {5,0};
 	
-	UCS(graph, start,goal);
+	csr_graph g = csr_from_matrix(graph);
+	workspace w = workspace_create(g.n);
+	search_stats st = UCS(g, w, start,goal);
+	print_stats(st);
+	//the same query searched from both ends
+	csr_graph r = csr_reverse(g);
+	search_state bs = state_create(g.n);
+	st = UCS_bidirectional(g,r,w.s,bs,start,goal);
+	print_stats(st);
+	state_free(bs);
+	csr_free(r);
+	workspace_free(w);
+	//a batch of queries on the engine
+	int queries[3][2] = {{0, 5}, {3, 2}, {5, 1}};
+	query_result result[3];
+	query_engine q = engine_create(g);
+	engine_run(q,queries,3,result);
+	printf("\n BATCH:");
+	for (int i = 0; i<3; i++){
+		printf("\n %s -> ",name(result[i].start));
+		printf("%s: cost %0.1f, path ",name(result[i].goal),result[i].cost);
+		for (int k = 0; k<result[i].length; k++)
+			printf("%s->",name(result[i].path[k]));
+	}
+	printf("\n");
+	result_free(result,3);
+	engine_free(q);
+	csr_free(g);
 	return 0;
 }
@@ -1,74 +1,673 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#ifdef _WIN32
 #include <windows.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#define Sleep(ms) usleep((ms) * 1000)   // the output is paced the same way off Windows
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define NUM_VERTICES 5
 #define MAX_COLORS 3
+#define ALIGN 64   // buffers start on a cache line
+#define SPLIT_DEPTH 4   // the parallel search makes a task of every choice above this depth
 
-bool consistent(int i, int c, char graph[][NUM_VERTICES], int colors[]) {
-    for (int j = 0; j < NUM_VERTICES; j++) {
-        if (graph[i][j] ==1 && colors[j] == c) {
-            return false;
+typedef unsigned long long word;
+
+// give the processor to another ready thread
+void yield_thread() {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// allocate size bytes aligned to ALIGN and filled with zeros
+void *aligned_calloc(size_t size) {
+    void *p;
+#ifdef _WIN32
+    p = _aligned_malloc(size > 0 ? size : 1, ALIGN);
+#else
+    if (posix_memalign(&p, ALIGN, size > 0 ? size : 1) != 0)
+        p = NULL;
+#endif
+    if (p == NULL) {
+        printf("\n out of memory (%lu bytes)\n", (unsigned long)size);
+        exit(1);
+    }
+    memset(p, 0, size);
+    return p;
+}
+
+void aligned_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// bit-packed adjacency matrix: bit j of row i is set when i and j are adjacent,
+// one bit per pair instead of one char
+struct bit_graph {
+    int n, words;   // words per row, rounded up so every row is aligned
+    word *bits;
+};
+
+bit_graph graph_create(int n) {
+    bit_graph g;
+    int per_line = ALIGN / sizeof(word);
+    g.n = n;
+    g.words = ((n + 63) / 64 + per_line - 1) / per_line * per_line;
+    g.bits = (word*)aligned_calloc((size_t)n * g.words * sizeof(word));
+    return g;
+}
+
+void graph_free(bit_graph &g) {
+    aligned_free(g.bits);
+}
+
+word *row(bit_graph &g, int i) {
+    return g.bits + (size_t)i * g.words;
+}
+
+void add_edge(bit_graph &g, int i, int j) {
+    row(g, i)[j >> 6] |= 1ULL << (j & 63);
+    row(g, j)[i >> 6] |= 1ULL << (i & 63);
+}
+
+// random graph, every pair is an edge with probability density
+bit_graph random_graph(int n, double density) {
+    bit_graph g = graph_create(n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < i; j++)
+            if (rand() < density * ((double)RAND_MAX + 1))
+                add_edge(g, i, j);
+    return g;
+}
+
+// read a DIMACS coloring file: "p edge n m" and edges "e u v" with vertices
+// from 1, lines starting with c are comments
+bool read_col(const char *file, bit_graph &g) {
+    FILE *f = fopen(file, "r");
+    if (f == NULL)
+        return false;
+    char line[256];
+    g.n = -1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        int u, v;
+        if (line[0] == 'p' && g.n < 0) {
+            char kind[16];
+            if (sscanf(line, "p %15s %d", kind, &u) != 2 || u < 0)
+                break;
+            g = graph_create(u);
+        }
+        else if (line[0] == 'e' && g.n >= 0 && sscanf(line, "e %d %d", &u, &v) == 2) {
+            if (u < 1 || u > g.n || v < 1 || v > g.n) {
+                printf("\n bad edge: %s", line);
+                graph_free(g);
+                g.n = -1;
+                break;
+            }
+            if (u != v)
+                add_edge(g, u - 1, v - 1);
+        }
+    }
+    fclose(f);
+    return g.n >= 0;
+}
+
+// number of bits set in both a and b
+int common(const word *a, const word *b, int words) {
+    int s = 0;
+    for (int w = 0; w < words; w++)
+        s += __builtin_popcountll(a[w] & b[w]);
+    return s;
+}
+
+// state of the coloring search: domain + v * dw is the bitmask of the colors
+// vertex v can still take and size[v] their number, trail holds the vertices
+// that lost a color so that the removals can be undone
+struct csp {
+    int n, k, dw;   // dw = words per domain
+    word *domain;
+    int *size, *degree;
+    int *trail, top;
+};
+
+// a choice point of the search: vertex v is tried with color c, the
+// removals made by the choice start at trail, used is the number of
+// colors in use before v
+struct frame {
+    int v, c, trail, used;
+};
+
+csp csp_create(bit_graph &g, int k) {
+    csp s;
+    s.n = g.n;
+    s.k = k;
+    s.dw = (k + 63) / 64;
+    s.domain = (word*)aligned_calloc((size_t)g.n * s.dw * sizeof(word));
+    s.size = (int*)aligned_calloc(g.n * sizeof(int));
+    s.degree = (int*)aligned_calloc(g.n * sizeof(int));
+    // a removed color is not removed again before it is given back, so at
+    // most n*k removals are on the trail
+    s.trail = (int*)aligned_calloc(((size_t)g.n * k + 1) * sizeof(int));
+    s.top = 0;
+    for (int v = 0; v < g.n; v++) {
+        word *d = s.domain + (size_t)v * s.dw;
+        for (int c = 0; c < k; c++)
+            d[c >> 6] |= 1ULL << (c & 63);
+        s.size[v] = k;
+        word *r = row(g, v);
+        for (int w = 0; w < g.words; w++)
+            s.degree[v] += __builtin_popcountll(r[w]);
+    }
+    return s;
+}
+
+// back to the start: no color removed
+void csp_reset(csp &s) {
+    for (int v = 0; v < s.n; v++) {
+        word *d = s.domain + (size_t)v * s.dw;
+        for (int w = 0; w < s.dw; w++)
+            d[w] = 0;
+        for (int c = 0; c < s.k; c++)
+            d[c >> 6] |= 1ULL << (c & 63);
+        s.size[v] = s.k;
+    }
+    s.top = 0;
+}
+
+void csp_free(csp &s) {
+    aligned_free(s.domain);
+    aligned_free(s.size);
+    aligned_free(s.degree);
+    aligned_free(s.trail);
+}
+
+bool has_color(csp &s, int v, int c) {
+    return (s.domain[(size_t)v * s.dw + (c >> 6)] >> (c & 63) & 1) != 0;
+}
+
+// give back color c to the vertices removed since mark
+void undo(csp &s, int mark, int c) {
+    while (s.top > mark) {
+        int v = s.trail[--s.top];
+        s.domain[(size_t)v * s.dw + (c >> 6)] |= 1ULL << (c & 63);
+        s.size[v]++;
+    }
+}
+
+// color v with c and remove c from its uncolored neighbors (forward
+// checking), false if a neighbor has no color left
+bool assign(bit_graph &g, csp &s, int colors[], int v, int c) {
+    colors[v] = c + 1;
+    word *r = row(g, v);
+    for (int w = 0; w < g.words; w++) {
+        for (word x = r[w]; x != 0; x &= x - 1) {
+            int u = w * 64 + __builtin_ctzll(x);
+            if (colors[u] < 0 && has_color(s, u, c)) {
+                s.domain[(size_t)u * s.dw + (c >> 6)] &= ~(1ULL << (c & 63));
+                s.trail[s.top++] = u;
+                if (--s.size[u] == 0)
+                    return false;
+            }
         }
     }
     return true;
 }
 
-bool backtrack(int i, char graph[][NUM_VERTICES], int colors[]) {
-    if (i == NUM_VERTICES) {
-        return true; // all nodes are colored
+// DSATUR: the uncolored vertex with the fewest colors left, ties go to the
+// highest degree, -1 if all vertices are colored
+int select_vertex(csp &s, int colors[]) {
+    int best = -1;
+    for (int v = 0; v < s.n; v++) {
+        if (colors[v] >= 0)
+            continue;
+        if (best < 0 || s.size[v] < s.size[best] ||
+            (s.size[v] == s.size[best] && s.degree[v] > s.degree[best]))
+            best = v;
+    }
+    return best;
+}
+
+// depth first search with an explicit stack of choice points from the
+// current state, v is the next vertex and used the number of colors in use;
+// with count == NULL it stops at the first coloring and leaves it in colors[],
+// otherwise it adds the number of colorings to *count (colorings that differ
+// only by a renaming of the colors are counted once); it gives up when stop
+// is set
+bool search(bit_graph &g, csp &s, int colors[], frame stack[], int v, int used,
+            long long *count, volatile int &stop) {
+    int k = s.k, depth = 0, base = s.top;
+    bool found = false;
+    stack[0].v = v;
+    stack[0].c = -1;
+    stack[0].trail = base;
+    stack[0].used = used;
+    while (!found && depth >= 0 && !stop) {
+        frame &f = stack[depth];
+        // take back the last color tried for f.v
+        if (f.c >= 0)
+            undo(s, f.trail, f.c);
+        colors[f.v] = -1;
+        // next color of the domain, a color that is not used yet is tried
+        // only once since unused colors are interchangeable
+        int limit = f.used < k ? f.used + 1 : k;
+        int c = f.c + 1;
+        while (c < limit && !has_color(s, f.v, c))
+            c++;
+        if (c >= limit) {
+            depth--; // no color left for f.v
+            continue;
+        }
+        f.c = c;
+        if (!assign(g, s, colors, f.v, c))
+            continue; // a neighbor has no color left
+        int next = select_vertex(s, colors);
+        if (next < 0) {
+            // all nodes are colored
+            if (count == NULL)
+                found = true;
+            else
+                (*count)++;
+            continue;
+        }
+        frame &child = stack[++depth];
+        child.v = next;
+        child.c = -1;
+        child.trail = s.top;
+        child.used = c + 1 > f.used ? c + 1 : f.used;
+    }
+    return found;
+}
+
+// search for a coloring with colors 1..k, colors[] must be -1 on entry
+bool backtrack(bit_graph &g, int k, int colors[]) {
+    csp s = csp_create(g, k);
+    frame *stack = (frame*)aligned_calloc((g.n + 1) * sizeof(frame));
+    volatile int stop = 0;
+    int v = select_vertex(s, colors);
+    bool found = true; // no vertices
+    if (v >= 0)
+        found = search(g, s, colors, stack, v, 0, NULL, stop);
+    aligned_free(stack);
+    csp_free(s);
+    return found;
+}
+
+// a subtree of the parallel search: the choices of the path from the root
+struct task {
+    int depth;
+    int v[SPLIT_DEPTH], c[SPLIT_DEPTH];
+};
+
+// double-ended queue of tasks of one thread, the owner takes the newest
+// task (deepest, depth first) and thieves take the oldest (largest subtree)
+struct deque {
+    task *items;
+    int capacity, head, tail;   // items[head..tail)
+#ifdef _OPENMP
+    omp_lock_t lock;
+#endif
+};
+
+void lock(deque &q) {
+#ifdef _OPENMP
+    omp_set_lock(&q.lock);
+#else
+    (void)q;
+#endif
+}
+
+void unlock(deque &q) {
+#ifdef _OPENMP
+    omp_unset_lock(&q.lock);
+#else
+    (void)q;
+#endif
+}
+
+void push(deque &q, task &t) {
+    lock(q);
+    if (q.tail == q.capacity) {
+        // move the tasks to the front, grow when more than half full
+        int n = q.tail - q.head;
+        if (2 * n > q.capacity) {
+            q.capacity *= 2;
+            q.items = (task*)realloc(q.items, q.capacity * sizeof(task));
+        }
+        memmove(q.items, q.items + q.head, n * sizeof(task));
+        q.head = 0;
+        q.tail = n;
+    }
+    q.items[q.tail++] = t;
+    unlock(q);
+}
+
+// the owner's end
+bool pop(deque &q, task &t) {
+    lock(q);
+    bool ok = q.tail > q.head;
+    if (ok)
+        t = q.items[--q.tail];
+    unlock(q);
+    return ok;
+}
+
+// the thieves' end
+bool steal(deque &q, task &t) {
+    lock(q);
+    bool ok = q.tail > q.head;
+    if (ok)
+        t = q.items[q.head++];
+    unlock(q);
+    return ok;
+}
+
+// parallel search with work stealing: choices above SPLIT_DEPTH become tasks
+// in the deque of the thread that made them, a thread with no task steals
+// from the others; the first thread to find a coloring copies it to colors[]
+// and stops the others, with count != NULL all colorings are counted
+bool backtrack_parallel(bit_graph &g, int k, int colors[], int threads, long long *count) {
+    deque *q = (deque*)aligned_calloc(threads * sizeof(deque));
+    for (int i = 0; i < threads; i++) {
+        q[i].capacity = 64;
+        q[i].items = (task*)malloc(q[i].capacity * sizeof(task));
+#ifdef _OPENMP
+        omp_init_lock(&q[i].lock);
+#endif
+    }
+    volatile int stop = 0;
+    volatile int pending = 1;   // tasks pushed and not finished
+    long long total = 0;
+    task root;
+    root.depth = 0;
+    push(q[0], root);
+    #pragma omp parallel num_threads(threads) reduction(+:total)
+    {
+        int id = 0;
+#ifdef _OPENMP
+        id = omp_get_thread_num();
+#endif
+        csp s = csp_create(g, k);
+        frame *stack = (frame*)aligned_calloc((g.n + 1) * sizeof(frame));
+        int *own = (int*)aligned_calloc(g.n * sizeof(int));
+        while (!stop && pending > 0) {
+            task t;
+            bool ok = pop(q[id], t);
+            for (int i = 1; !ok && i < threads; i++)
+                ok = steal(q[(id + i) % threads], t);
+            if (!ok) {
+                yield_thread(); // until a task is pushed or all are done
+                continue;
+            }
+            // replay the path of the task, it was consistent when pushed
+            csp_reset(s);
+            for (int v = 0; v < g.n; v++)
+                own[v] = -1;
+            int used = 0;
+            for (int d = 0; d < t.depth; d++) {
+                assign(g, s, own, t.v[d], t.c[d]);
+                if (t.c[d] + 1 > used)
+                    used = t.c[d] + 1;
+            }
+            int v = select_vertex(s, own);
+            long long n = 0;
+            bool found = false;
+            if (v < 0) {
+                // all nodes are colored
+                n = 1;
+                found = true;
+            }
+            else if (t.depth < SPLIT_DEPTH) {
+                // one task per color of v, pushed from the last color so
+                // that the owner tries them in the sequential order
+                int limit = used < k ? used + 1 : k;
+                for (int c = limit - 1; c >= 0; c--) {
+                    int mark = s.top;
+                    if (has_color(s, v, c) && assign(g, s, own, v, c)) {
+                        task child = t;
+                        child.v[t.depth] = v;
+                        child.c[t.depth] = c;
+                        child.depth++;
+                        __sync_fetch_and_add(&pending, 1);
+                        push(q[id], child);
+                    }
+                    undo(s, mark, c);
+                    own[v] = -1;
+                }
+            }
+            else {
+                found = search(g, s, own, stack, v, used, count != NULL ? &n : NULL, stop);
+            }
+            total += n;
+            if (found && count == NULL && __sync_bool_compare_and_swap(&stop, 0, 1))
+                memcpy(colors, own, g.n * sizeof(int));
+            __sync_fetch_and_sub(&pending, 1);
+        }
+        aligned_free(own);
+        aligned_free(stack);
+        csp_free(s);
+    }
+    for (int i = 0; i < threads; i++) {
+#ifdef _OPENMP
+        omp_destroy_lock(&q[i].lock);
+#endif
+        free(q[i].items);
+    }
+    aligned_free(q);
+    if (count != NULL) {
+        *count = total;
+        return total > 0;
+    }
+    return stop != 0;
+}
+
+// order of the greedy coloring
+struct by_degree {
+    int degree, v;
+};
+
+int compare_degree(const void *a, const void *b) {
+    const by_degree *x = (const by_degree*)a, *y = (const by_degree*)b;
+    if (x->degree != y->degree)
+        return y->degree - x->degree;
+    return x->v - y->v;
+}
+
+// greedy coloring (Welsh-Powell): the vertices by decreasing degree take the
+// first color that none of their neighbors has, returns the number of colors
+int greedy(bit_graph &g, int colors[]) {
+    by_degree *order = (by_degree*)aligned_calloc(g.n * sizeof(by_degree));
+    for (int v = 0; v < g.n; v++) {
+        order[v].v = v;
+        order[v].degree = common(row(g, v), row(g, v), g.words);
+    }
+    qsort(order, g.n, sizeof(by_degree), compare_degree);
+    // members + c * g.words is the bitset of the vertices with color c
+    word *members = (word*)aligned_calloc((size_t)g.n * g.words * sizeof(word));
+    int k = 0;
+    for (int i = 0; i < g.n; i++) {
+        int v = order[i].v, c = 0;
+        while (c < k && common(row(g, v), members + (size_t)c * g.words, g.words) > 0)
+            c++;
+        if (c == k)
+            k++;
+        colors[v] = c;
+        members[(size_t)c * g.words + (v >> 6)] |= 1ULL << (v & 63);
+    }
+    aligned_free(members);
+    aligned_free(order);
+    return k;
+}
+
+// chromatic number mode: a greedy coloring gives the first number of colors
+// k, then k-1 colors are tried first from the k-coloring, where only the
+// vertices of its smallest color class are searched and the others keep
+// their colors, and only when that fails with a full search; returns the
+// fewest colors, which is the chromatic number, colors[] holds the coloring
+int fewest_colors(bit_graph &g, int colors[]) {
+    int k = greedy(g, colors);
+    for (int v = 0; v < g.n; v++)
+        colors[v]++;
+    printf("greedy: %d colors\n", k);
+    int *trial = (int*)aligned_calloc(g.n * sizeof(int));
+    int *size = (int*)aligned_calloc((k + 1) * sizeof(int));
+    frame *stack = (frame*)aligned_calloc((g.n + 1) * sizeof(frame));
+    volatile int stop = 0;
+    while (k > 1) {
+        // the smallest class is searched again, the last color takes its place
+        for (int c = 1; c <= k; c++)
+            size[c] = 0;
+        for (int v = 0; v < g.n; v++)
+            size[colors[v]]++;
+        int drop = 1;
+        for (int c = 2; c <= k; c++)
+            if (size[c] < size[drop])
+                drop = c;
+        csp s = csp_create(g, k - 1);
+        bool warm = true;
+        for (int v = 0; v < g.n; v++)
+            trial[v] = -1;
+        for (int v = 0; v < g.n && warm; v++) {
+            int c = colors[v] == k ? drop : colors[v];
+            if (colors[v] != drop)
+                warm = has_color(s, v, c - 1) && assign(g, s, trial, v, c - 1);
+        }
+        if (warm) {
+            int v = select_vertex(s, trial);
+            if (v >= 0)
+                warm = search(g, s, trial, stack, v, k - 1, NULL, stop);
+        }
+        csp_free(s);
+        bool found = warm;
+        if (!found) {
+            for (int v = 0; v < g.n; v++)
+                trial[v] = -1;
+            found = backtrack(g, k - 1, trial);
+        }
+        if (!found)
+            break; // k is the fewest
+        memcpy(colors, trial, g.n * sizeof(int));
+        k--;
+        printf("found: %d colors (%s)\n", k, warm ? "warm" : "full search");
+    }
+    aligned_free(stack);
+    aligned_free(size);
+    aligned_free(trial);
+    return k;
+}
+
+// usage: backtracking [-p threads] [-a] [-c] [graph.col | -r vertices density] [colors]
+// without arguments the example graph is colored with MAX_COLORS colors,
+// -p searches in parallel (0 threads = all), -a counts all colorings,
+// -c finds the fewest colors
+int main(int argc, char *argv[]) {
+	srand(time(0));
+    bit_graph g;
+    int k = MAX_COLORS;
+    int threads = 0;
+    bool all = false, fewest = false;
+    while (argc > 1 && argv[1][0] == '-' && argv[1][1] != 'r') {
+        if (strcmp(argv[1], "-a") == 0 || strcmp(argv[1], "-c") == 0) {
+            all = all || argv[1][1] == 'a';
+            fewest = fewest || argv[1][1] == 'c';
+            argc--;
+            argv++;
+        }
+        else if (strcmp(argv[1], "-p") == 0 && argc > 2) {
+            threads = atoi(argv[2]);
+#ifdef _OPENMP
+            if (threads <= 0)
+                threads = omp_get_max_threads();
+#endif
+            if (threads <= 0)
+                threads = 1;
+            argc -= 2;
+            argv += 2;
+        }
+        else
+            break;
+    }
+    if (argc > 3 && strcmp(argv[1], "-r") == 0) {
+        // create a random graph of the given size
+        g = random_graph(atoi(argv[2]), atof(argv[3]));
+        if (argc > 4)
+            k = atoi(argv[4]);
     }
-    for (int c = 1; c <= MAX_COLORS; c++) {
-        if (consistent(i, c, graph, colors)) {
-            colors[i] = c;
-            if (backtrack(i + 1, graph, colors)) {
-                return true; // found a valid color assignment
+    else if (argc > 1) {
+        if (!read_col(argv[1], g)) {
+            printf("\n cannot load the graph %s\n", argv[1]);
+            return 1;
+        }
+        if (argc > 2)
+            k = atoi(argv[2]);
+    }
+    else {
+ 	    //example adjacency matrix representing a graph with 5 vertices and 5 colors
+        char graph[NUM_VERTICES][NUM_VERTICES] = {
+            {0, 1, 1, 0, 0},
+            {1, 0, 1, 0, 0},
+            {1, 1, 0, 1, 0},
+            {0, 0, 1, 0, 1},
+            {0, 0, 0, 1, 0}
+        };  
+        // pack the matrix into bits
+        g = graph_create(NUM_VERTICES);
+        for (int i = 0; i < NUM_VERTICES; i++) {
+            for (int j = 0; j < i; j++) {
+                if (graph[i][j] == 1) {
+                    add_edge(g, i, j);
+                }
             }
-            colors[i] = -1; // reset color if no valid color assignment found
-        }
-    }
-    return false; // no valid color assignment found
-}
-
-int main() {
-	//srand(time(0));
- 	//example adjacency matrix representing a graph with 5 vertices and 5 colors
-    char graph[NUM_VERTICES][NUM_VERTICES] = {
-        {0, 1, 1, 0, 0},
-        {1, 0, 1, 0, 0},
-        {1, 1, 0, 1, 0},
-        {0, 0, 1, 0, 1},
-        {0, 0, 0, 1, 0}
-    };  
-    /*
-     // create a random graph
-    char graph[NUM_VERTICES][NUM_VERTICES];
-    for (int i = 0; i<NUM_VERTICES; i++){
-    	for (int j = 0; j<=i; j++){
-    		graph[i][j] = rand() % 2;    		
-    		graph[j][i] = graph[i][j];
-    		graph[i][i] = 0;    		
-		}
-	}
+        }
+    }
+    if (k < 1) {
+        printf("\n the number of colors must be positive\n");
+        graph_free(g);
+        return 1;
+    }
 	/*
 	//print	
-	for (int i = 0; i<NUM_VERTICES; i++){
-    	for (int j = 0; j<NUM_VERTICES; j++){
-    		printf("%5d",graph[i][j]);
+	for (int i = 0; i<g.n; i++){
+    	for (int j = 0; j<g.n; j++){
+    		printf("%5d",(int)(row(g, i)[j >> 6] >> (j & 63) & 1));
     	}
     	printf("\n");
     }
     */
 	// array to store the colors for each node                             
-    int colors[NUM_VERTICES]; 
+    int *colors = (int*)aligned_calloc(g.n * sizeof(int)); 
     // initialize colors to -1 (no color assigned)
-    for (int i = 0; i < NUM_VERTICES; i++) {
+    for (int i = 0; i < g.n; i++) {
         colors[i] = -1; 
     }
 
-    if (backtrack(0, graph, colors)) {
-        for (int i = 0; i < NUM_VERTICES; i++) {
+    if (fewest) {
+        k = fewest_colors(g, colors);
+        printf("Colors: %d\n", k);
+        for (int i = 0; i < g.n; i++) {
+            printf("Vertex %d <-- color %d\n", i, colors[i]);
+            Sleep(1);
+        }
+    }
+    else if (all) {
+        long long count = 0;
+        backtrack_parallel(g, k, colors, threads > 0 ? threads : 1, &count);
+        printf("Number of colorings: %lld\n", count);
+    }
+    else if (threads > 0 ? backtrack_parallel(g, k, colors, threads, NULL) : backtrack(g, k, colors)) {
+        for (int i = 0; i < g.n; i++) {
             printf("Vertex %d <-- color %d\n", i, colors[i]);
             Sleep(1);
         }
@@ -76,6 +675,7 @@ int main() {
 	else {
         printf("\n There exists no solution.\n");
     }
+    aligned_free(colors);
+    graph_free(g);
     return 0;
 }
-
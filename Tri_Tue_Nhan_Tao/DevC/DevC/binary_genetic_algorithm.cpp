@@ -1,124 +1,499 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define POP_SIZE 10  // k�ch thu?c qu?n th?
 #define NUM_GENES 5    // d? d�i chu?i gen
 #define MUT_RATE 0.01  // t? l? d?t bi?n
+#define ELITE 1        // best individuals copied unchanged to the next generation
+#define ALIGN 64   // buffers start on a cache line
+#define GENERATIONS 1000
+#define MIGRATE_EVERY 20   // generations between two migrations of the islands
+#define MIGRANTS 2         // individuals sent to each neighbor island
+
+typedef unsigned long long word;
+
+// sizes of the run, POP_SIZE and NUM_GENES unless given on the command line
+int pop_size = POP_SIZE;
+int num_genes = NUM_GENES;
+// parents are chosen by roulette (0) or by tournaments of this size
+int tournament = 0;
+int elite = ELITE;
+// island model: number of islands and their layout, a ring or a torus
+int num_islands = 1;
+bool torus = false;
+// random numbers of the population being evolved, each thread has its own
+// generator and each island saves its state between generations
+word rng;
+#pragma omp threadprivate(rng)
+
+// allocate size bytes aligned to ALIGN and filled with zeros
+void *aligned_calloc(size_t size) {
+	void *p;
+#ifdef _WIN32
+	p = _aligned_malloc(size > 0 ? size : 1, ALIGN);
+#else
+	if (posix_memalign(&p, ALIGN, size > 0 ? size : 1) != 0)
+		p = NULL;
+#endif
+	if (p == NULL) {
+		printf("out of memory (%lu bytes)\n", (unsigned long)size);
+		exit(1);
+	}
+	memset(p, 0, size);
+	return p;
+}
+
+void aligned_free(void *p) {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+// a population in one buffer: the genes of individual i are the words
+// words from bits + i*words, gene j is bit 63-(j&63) of word j>>6 so the
+// genes from left to right are the bits from the highest; the bits after
+// the last gene are 0; fit[i] is the fitness of individual i and prefix[i]
+// the sum of the positive fitness of individuals 0..i, both set by evaluate()
+struct gene_pool {
+	int size, words;
+	word *bits;
+	float *fit;
+	double *prefix;
+};
+
+gene_pool pool_create(int size) {
+	gene_pool p;
+	p.size = size;
+	p.words = (num_genes + 63) / 64;
+	p.bits = (word*)aligned_calloc((size_t)size * p.words * sizeof(word));
+	p.fit = (float*)aligned_calloc(size * sizeof(float));
+	p.prefix = (double*)aligned_calloc(size * sizeof(double));
+	return p;
+}
+
+void pool_free(gene_pool &p) {
+	aligned_free(p.bits);
+	aligned_free(p.fit);
+	aligned_free(p.prefix);
+}
+
+word* genome(gene_pool &p, int i) {
+	return p.bits + (size_t)i * p.words;
+}
+
+int gene(const word* genes, int j) {
+	return (int)(genes[j >> 6] >> (63 - (j & 63)) & 1);
+}
+
+void print_genes(const word* genes) {
+	for (int j = 0; j < num_genes; j++)
+		printf("%d", gene(genes, j));
+}
+
+// xorshift random numbers
+word next_random(word &state) {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+// a nonzero generator state from any number (splitmix)
+word seed_random(word x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x != 0 ? x : 1;
+}
+
+// random number in (0, 1]
+double uniform() {
+	return ((next_random(rng) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
 
 // h�m t�nh gi� tr? f(x)
-float f(int x) {
+float f(double x) {
     return (-x*x/10.0 + 3.0*x);
 }
 
+//objective computed from the whole genome, for objectives that are not a
+//function of x; it may be costly, a batch of genomes is evaluated in parallel
+typedef float (*objective)(const word* genes);
+objective user_objective = NULL;   //NULL = f(x)
+
 // h�m t�nh gi� tr? fitness c?a m?t c� th?
-float fitness(int* genes) {	
-	int x = 0;
-	for (int i = 0; i < NUM_GENES; i++) {    
-        x += genes[i] * pow(2,NUM_GENES - i - 1);
-    }
+float fitness(const word* genes) {	
+	if (user_objective != NULL)
+		return user_objective(genes);
+	//x = the genes read as a binary number, the highest bits of the first word
+	double x = (double)(genes[0] >> (64 - num_genes));
     return f(x);
 }
 
+//an example of a user objective: the number of genes equal to 1 (any length)
+float ones(const word* genes) {
+	int n = 0;
+	for (int w = 0; w < (num_genes + 63) / 64; w++)
+		n += __builtin_popcountll(genes[w]);
+	return (float)n;
+}
+
+//batch fitness: the fitness of every genome of the population into fit[];
+//the general version calls the objective o(genes) for each genome in a
+//parallel loop
+template <class O>
+void fitness_batch(gene_pool &population, O o) {
+	#pragma omp parallel for schedule(dynamic,16)
+	for (int i = 0; i < population.size; i++)
+		population.fit[i] = o(genome(population, i));
+}
+
+//objective given by a function pointer
+struct by_genome {
+	objective o;
+	float operator()(const word* genes) const {
+		return o(genes);
+	}
+};
+
+//the closed-form objective f(x): x is one shift of the first word of each
+//genome, f is inlined and the loop has no calls, so it can be vectorized
+struct closed_form {};
+
+template <>
+void fitness_batch<closed_form>(gene_pool &population, closed_form) {
+	int shift = 64 - num_genes;
+	const word* bits = population.bits;
+	float* fit = population.fit;
+	int words = population.words;
+	#pragma omp simd
+	for (int i = 0; i < population.size; i++)
+		fit[i] = f((double)(bits[(size_t)i * words] >> shift));
+}
+
 // h�m ch?n l?c c� th? d? lai gh�p
-int select_parent(int** population) {
-    float sum_fitness = 0;
-    for (int i = 0; i < POP_SIZE; i++) {
-        sum_fitness += fitness(population[i]);
+int select_parent(gene_pool &population) {
+    if (tournament > 0) {
+        //the best of tournament individuals taken at random
+        int best = (int)(uniform() * population.size) % population.size;
+        for (int t = 1; t < tournament; t++) {
+            int i = (int)(uniform() * population.size) % population.size;
+            if (population.fit[i] > population.fit[best])
+                best = i;
+        }
+        return best;
     }
-    //int r = rand() % sum_fitness;
-    float r = ((double) rand() / RAND_MAX) * sum_fitness;    
-    int i = 0;
-    float partial_sum = 0;
-    while (partial_sum < r) {
-        partial_sum += fitness(population[i]);
-        i++;
+    //roulette: i is chosen with probability fit[i] / sum of fit, negative
+    //fitness counts as 0 and all are equally likely when no fitness is positive
+    double sum_fitness = population.prefix[population.size - 1];
+    if (sum_fitness <= 0)
+        return (int)(uniform() * population.size) % population.size;
+    double r = uniform() * sum_fitness;
+    //binary search for the first i with prefix[i] >= r
+    int lo = 0, hi = population.size - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (population.prefix[mid] >= r)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+//compute the fitness of every individual once per generation, and the prefix
+//sums for the roulette
+void evaluate(gene_pool &population) {
+    if (user_objective != NULL) {
+        by_genome o = { user_objective };
+        fitness_batch(population, o);
+    }
+    else
+        fitness_batch(population, closed_form());
+    double sum = 0;
+    for (int i = 0; i < population.size; i++) {
+        if (population.fit[i] > 0)
+            sum += population.fit[i];
+        population.prefix[i] = sum;
     }
-    return i-1;
 }
 
 // h�m lai gh�p hai c� th?
-void crossover(int* parent1, int* parent2, int* child) {
-    int crossover_point = rand() % NUM_GENES;
-   	for (int i = 0; i < crossover_point; i++)
+//the genes before the crossover point come from parent1: whole words are
+//copied and the word of the point is mixed with a mask
+void crossover(const word* parent1, const word* parent2, word* child) {
+    int crossover_point = (int)(uniform() * num_genes) % num_genes;
+    int words = (num_genes + 63) / 64, w = crossover_point >> 6;
+   	for (int i = 0; i < w; i++)
         child[i] = parent1[i];
-	
-	for (int i = crossover_point; i < NUM_GENES; i++)
+	//the highest crossover_point % 64 bits of word w come from parent1
+	word mask = (crossover_point & 63) == 0 ? 0 : ~0ULL << (64 - (crossover_point & 63));
+	child[w] = (parent1[w] & mask) | (parent2[w] & ~mask);
+	for (int i = w + 1; i < words; i++)
 		child[i] = parent2[i];
 }
 
 // h�m d?t bi?n m?t c� th?
-void mutate(int* genes) {
-	for (int i = 0; i < NUM_GENES; i++) {
-		if ((double)rand() / RAND_MAX < MUT_RATE) {
-			genes[i] = 1 - genes[i];
-		}
+//instead of a random number per gene, the distance to the next flipped
+//gene is drawn: P(distance = s) = (1 - MUT_RATE)^s * MUT_RATE
+void mutate(word* genes) {
+	double scale = 1.0 / log(1.0 - MUT_RATE);
+	for (double j = floor(log(uniform()) * scale); j < num_genes; j += 1 + floor(log(uniform()) * scale)) {
+		int i = (int)j;
+		genes[i >> 6] ^= 1ULL << (63 - (i & 63));
 	}
 }
 
 // h�m t?o ra qu?n th? ban d?u
-void create_population(int** population) {
+void create_population(gene_pool &population) {
 	printf("First generation:\n");
-	for (int i = 0; i < POP_SIZE; i++) {
-		population[i] = (int*)malloc(NUM_GENES * sizeof(int));
-		for (int j = 0; j < NUM_GENES; j++) {
-			population[i][j] = rand() % 2;
-			//
-			printf("%d",population[i][j]);
+	for (int i = 0; i < population.size; i++) {
+		word* genes = genome(population, i);
+		for (int j = 0; j < num_genes; j++) {
+			if (next_random(rng) >> 63)
+				genes[j >> 6] |= 1ULL << (63 - (j & 63));
 		}
-		printf(" = %.2f\n",fitness(population[i]));
+		//
+		print_genes(genes);
+		printf(" = %.2f\n",fitness(genes));
 	}
 }
 
 // h�m t�nh gi� tr? l?n nh?t c?a h�m s? f(x) trong qu?n th? hi?n t?i
-float max_fitness(int** population) {
-	float max_fit = fitness(population[0]);
+float max_fitness(gene_pool &population) {
+	evaluate(population);
+	float max_fit = population.fit[0];
 	int   k = 0;
-	for (int i = 1; i < POP_SIZE; i++) {
-		float fit = fitness(population[i]);
+	for (int i = 1; i < population.size; i++) {
+		float fit = population.fit[i];
 		if (fit > max_fit){
 			max_fit = fit;
 			k = i;
 		}
 	}
 	printf("\nLast generation\n");
-	for (int i = 0; i <POP_SIZE; i++ ){
-		for (int j = 0; j<NUM_GENES; j++)
-			printf("%d",population[i][j]);
-		printf(" = %.2f\n",fitness(population[i]));
+	for (int i = 0; i <population.size; i++ ){
+		print_genes(genome(population, i));
+		printf(" = %.2f\n",population.fit[i]);
 	}
 	printf("\n Max gen = %d :",k);
 	return max_fit;
 }
 
+//the m best individuals (the m worst with worst = true) into best[], best
+//first; best[] has room for m+1 indices
+int top(gene_pool &population, int m, int best[], bool worst) {
+	int n = 0;
+	for (int i = 0; i < population.size; i++) {
+		float fit = worst ? -population.fit[i] : population.fit[i];
+		int j = n < m ? n++ : m;
+		while (j > 0 && fit > (worst ? -population.fit[best[j - 1]] : population.fit[best[j - 1]])) {
+			best[j] = best[j - 1];
+			j--;
+		}
+		best[j] = i;
+	}
+	return n;
+}
+
+//one generation: the children of population are written into
+//new_population and the two are swapped
+void next_generation(gene_pool &population, gene_pool &new_population, int best[]) {
+	evaluate(population);
+	//elitism: the best individuals are copied first
+	int n = top(population, elite, best, false);
+	for (int i = 0; i < n; i++)
+		memcpy(genome(new_population, i), genome(population, best[i]), population.words * sizeof(word));
+	for (int i = n; i < population.size; i++) {
+		int parent1 = select_parent(population);
+		int parent2 = select_parent(population);
+		crossover(genome(population, parent1),genome(population, parent2),genome(new_population, i));
+		mutate(genome(new_population, i));
+	}
+	gene_pool t = population;
+	population = new_population;
+	new_population = t;
+}
+
 // h�m t�m ki?m gi?i ph�p t?t nh?t
-void search(int** population) {
+//two buffers are allocated once: the children of a generation are written
+//into the other buffer and the two are swapped
+void search(gene_pool &population) {
 	int generation = 1;
-	while (generation < 1000) { // gi?i h?n s? th? h?
-		int** new_population = (int**)malloc(POP_SIZE * sizeof(int*));
-		for (int i = 0; i < POP_SIZE; i++) {
-			new_population[i] = (int*)malloc(NUM_GENES * sizeof(int));
-			int parent1 = select_parent(population);
-			int parent2 = select_parent(population);
-			crossover(population[parent1],population[parent2],new_population[i]);
-			mutate(new_population[i]);
+	gene_pool new_population = pool_create(pop_size);
+	//indices of the best individuals, best first
+	int *best = (int*)aligned_calloc((elite + 1) * sizeof(int));
+	while (generation < GENERATIONS) { // gi?i h?n s? th? h?
+		next_generation(population, new_population, best);
+		generation++;
+	}
+	aligned_free(best);
+	pool_free(new_population);
+	printf("\n Solution found in generation %d is %f",generation, max_fitness(population));
+}
+
+//an island: its population, the spare buffer, its random generator and the
+//mailbox where it leaves its best individuals for its neighbors
+struct island {
+	gene_pool population, new_population, outbox;
+	int *best;
+	word rng;
+};
+
+//the islands that send to island i: the previous one on a ring, the one on
+//the left and the one above on a rows x cols torus; returns their number
+int neighbors(int i, int from[]) {
+	if (!torus || num_islands < 4) {
+		from[0] = (i + num_islands - 1) % num_islands;
+		return 1;
+	}
+	int cols = (int)sqrt((double)num_islands);
+	while (num_islands % cols != 0)
+		cols--;
+	int rows = num_islands / cols, r = i / cols, c = i % cols;
+	from[0] = r * cols + (c + cols - 1) % cols;
+	from[1] = (r + rows - 1) % rows * cols + c;
+	return from[0] == from[1] ? 1 : 2;
+}
+
+//island model: the islands evolve in parallel, every MIGRATE_EVERY
+//generations each one copies its MIGRANTS best individuals to its mailbox
+//and, after all have done so, replaces its worst individuals with the
+//individuals in the mailboxes of its neighbors; a mailbox is written by one
+//island and read only after a barrier, so no lock is needed and the result
+//depends only on the seed, not on the threads
+void search_islands(island islands[], int migrants) {
+	int generation = 1;
+	while (generation < GENERATIONS) {
+		bool migrate = generation % MIGRATE_EVERY == 0 && num_islands > 1;
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < num_islands; i++) {
+			island &is = islands[i];
+			rng = is.rng;
+			next_generation(is.population, is.new_population, is.best);
+			if (migrate) {
+				evaluate(is.population);
+				int n = top(is.population, migrants, is.best, false);
+				for (int k = 0; k < n; k++)
+					memcpy(genome(is.outbox, k), genome(is.population, is.best[k]), is.population.words * sizeof(word));
+			}
+			is.rng = rng;
 		}
-		for (int i = 0; i < POP_SIZE; i++) {
-			free(population[i]);
+		if (migrate) {
+			#pragma omp parallel for schedule(static)
+			for (int i = 0; i < num_islands; i++) {
+				island &is = islands[i];
+				int from[2], n = neighbors(i, from);
+				top(is.population, n * migrants, is.best, true);
+				for (int s = 0; s < n; s++)
+					for (int k = 0; k < migrants; k++)
+						memcpy(genome(is.population, is.best[s * migrants + k]), genome(islands[from[s]].outbox, k), is.population.words * sizeof(word));
+			}
 		}
-		free(population);
-		population = new_population;
 		generation++;
 	}
-	printf("\n Solution found in generation %d is %f",generation, max_fitness(population));
+	float max_fit = 0;
+	int k = 0;
+	for (int i = 0; i < num_islands; i++) {
+		evaluate(islands[i].population);
+		int b;
+		top(islands[i].population, 1, &b, false);
+		printf("\n Island %d: max = %.2f", i, islands[i].population.fit[b]);
+		if (i == 0 || islands[i].population.fit[b] > max_fit) {
+			max_fit = islands[i].population.fit[b];
+			k = i;
+		}
+	}
+	printf("\n Solution found in generation %d on island %d is %f",generation, k, max_fit);
 }
 
-int main() {
-	srand(time(NULL));
-	int** population = (int**)malloc(POP_SIZE * sizeof(int*));
-	create_population(population);
-	search(population);
+// usage: binary_genetic_algorithm [-i islands] [-torus] [-s seed] [-ones]
+//                                 [population size] [genes] [tournament size] [elite]
+// the population size is per island, the same seed and number of islands
+// give the same result with any number of threads; -ones maximizes the
+// number of genes equal to 1 instead of f(x) and allows any number of genes
+int main(int argc, char *argv[]) {
+	word seed = (word)time(NULL);
+	while (argc > 1 && argv[1][0] == '-') {
+		if (strcmp(argv[1], "-torus") == 0 || strcmp(argv[1], "-ones") == 0) {
+			if (argv[1][1] == 't')
+				torus = true;
+			else
+				user_objective = ones;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[1], "-i") == 0 && argc > 2) {
+			num_islands = atoi(argv[2]);
+			argc -= 2;
+			argv += 2;
+		}
+		else if (strcmp(argv[1], "-s") == 0 && argc > 2) {
+			seed = strtoull(argv[2], NULL, 10);
+			argc -= 2;
+			argv += 2;
+		}
+		else
+			break;
+	}
+	if (argc > 1)
+		pop_size = atoi(argv[1]);
+	if (argc > 2)
+		num_genes = atoi(argv[2]);
+	if (argc > 3)
+		tournament = atoi(argv[3]);
+	if (argc > 4)
+		elite = atoi(argv[4]);
+	//x of f(x) is read from the first word
+	if (user_objective == NULL && num_genes > 64) {
+		printf("f(x) reads at most 64 genes\n");
+		return 1;
+	}
+	if (pop_size < 1 || num_genes < 1 || elite < 0 || elite > pop_size || num_islands < 1) {
+		printf("population size >= 1, genes >= 1, 0 <= elite <= population size and islands >= 1\n");
+		return 1;
+	}
+	if (num_islands == 1) {
+		rng = seed_random(seed);
+		gene_pool population = pool_create(pop_size);
+		create_population(population);
+		search(population);
+		pool_free(population);
+		return 0;
+	}
+	//at most half of an island is replaced by migrants
+	int migrants = MIGRANTS < pop_size / 4 ? MIGRANTS : pop_size / 4;
+	island *islands = (island*)aligned_calloc(num_islands * sizeof(island));
+	for (int i = 0; i < num_islands; i++) {
+		island &is = islands[i];
+		is.population = pool_create(pop_size);
+		is.new_population = pool_create(pop_size);
+		is.outbox = pool_create(migrants > 0 ? migrants : 1);
+		is.best = (int*)aligned_calloc((pop_size + 1) * sizeof(int));
+		rng = seed_random(seed + i);
+		printf("Island %d\n", i);
+		create_population(is.population);
+		is.rng = rng;
+	}
+	search_islands(islands, migrants);
+	for (int i = 0; i < num_islands; i++) {
+		pool_free(islands[i].population);
+		pool_free(islands[i].new_population);
+		pool_free(islands[i].outbox);
+		aligned_free(islands[i].best);
+	}
+	aligned_free(islands);
 	return 0;
 }
-
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//convert a text graph into the binary graph file that BFS, DFS, UCS and
+//Astar map into memory
+//usage: graph_converter [-u] input output [coordinates]
+//  input: a DIMACS shortest path file ("p sp n m" and arcs "a u v w" with
+//         vertices from 1) or an edge list "u v [w]" with vertices from 0,
+//         lines starting with c, # or % are comments
+//  -u: every edge is also added in the reverse direction
+//  coordinates: a DIMACS coordinate file ("v id x y")
+
+//file layout: a header, offset[n+1] and adj[m] as 32-bit integers, then
+//weight[m] and the coordinates x[n], y[n] as doubles when the flags say
+//so; the doubles start at a multiple of 8
+#define GRAPH_MAGIC 0x47525343
+#define HAS_WEIGHTS 1
+#define HAS_COORDS  2
+struct graph_header{
+	int magic;     //"CSRG"
+	int version;   //1
+	int n, m;
+	int flags;
+	int reserved[3];
+};
+//an edge of the input
+struct edge{
+	int u, v;
+	double w;
+};
+//edges read so far
+edge *edges = NULL;
+long num_edges = 0, max_edges = 0;
+//append an edge
+void add_edge(int u, int v, double w){
+	if (num_edges == max_edges){
+		max_edges = max_edges > 0 ? 2 * max_edges : 1024;
+		edges = (edge*)realloc(edges, max_edges * sizeof(edge));
+		if (edges == NULL){
+			printf("out of memory after %ld edges\n", num_edges);
+			exit(1);
+		}
+	}
+	edges[num_edges].u = u;
+	edges[num_edges].v = v;
+	edges[num_edges].w = w;
+	num_edges++;
+}
+//read a DIMACS file or an edge list, returns the number of vertices or -1
+int read_graph(const char *file, bool undirected, bool &weighted, bool &dimacs){
+	FILE *f = fopen(file, "r");
+	if (f == NULL)
+		return -1;
+	char line[256];
+	int n = 0;
+	weighted = false;
+	dimacs = false;
+	while (fgets(line, sizeof(line), f) != NULL){
+		if (line[0] == 'c' || line[0] == '#' || line[0] == '%' || line[0] == '\n')
+			continue;
+		int u, v, k;
+		double w = 1;
+		if (line[0] == 'p'){
+			//p sp n m
+			char kind[16];
+			long m;
+			if (sscanf(line, "p %15s %d %ld", kind, &n, &m) == 3)
+				dimacs = true;
+			continue;
+		}
+		if (line[0] == 'a'){
+			k = sscanf(line, "a %d %d %lf", &u, &v, &w);
+			if (k < 2)
+				continue;
+			u--;
+			v--;
+			weighted = weighted || k == 3;
+		}
+		else{
+			k = sscanf(line, "%d %d %lf", &u, &v, &w);
+			if (k < 2)
+				continue;
+			weighted = weighted || k == 3;
+		}
+		if (u < 0 || v < 0){
+			printf("bad edge: %s", line);
+			fclose(f);
+			return -1;
+		}
+		add_edge(u, v, w);
+		if (undirected)
+			add_edge(v, u, w);
+		if (u >= n)
+			n = u + 1;
+		if (v >= n)
+			n = v + 1;
+	}
+	fclose(f);
+	return n;
+}
+//read a DIMACS coordinate file into x[], y[]
+bool read_coordinates(const char *file, int n, bool dimacs, double x[], double y[]){
+	FILE *f = fopen(file, "r");
+	if (f == NULL)
+		return false;
+	char line[256];
+	while (fgets(line, sizeof(line), f) != NULL){
+		int id;
+		double a, b;
+		if (sscanf(line, "v %d %lf %lf", &id, &a, &b) != 3)
+			continue;
+		if (dimacs)
+			id--;
+		if (id >= 0 && id < n){
+			x[id] = a;
+			y[id] = b;
+		}
+	}
+	fclose(f);
+	return true;
+}
+int main(int argc, char *argv[]){
+	bool undirected = argc > 1 && strcmp(argv[1], "-u") == 0;
+	int arg = undirected ? 2 : 1;
+	if (argc - arg < 2){
+		printf("usage: graph_converter [-u] input output [coordinates]\n");
+		return 1;
+	}
+	bool weighted, dimacs;
+	int n = read_graph(argv[arg], undirected, weighted, dimacs);
+	if (n < 0){
+		printf("cannot read %s\n", argv[arg]);
+		return 1;
+	}
+	if (num_edges > 0x7FFFFFFF){
+		printf("too many edges: %ld\n", num_edges);
+		return 1;
+	}
+	int m = (int)num_edges;
+	//place the edges by source, in input order
+	int *offset = (int*)calloc(n + 1, sizeof(int));
+	int *adj = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+	double *weight = weighted ? (double*)malloc((m > 0 ? m : 1) * sizeof(double)) : NULL;
+	for (int e = 0; e<m; e++)
+		offset[edges[e].u + 1]++;
+	for (int v = 0; v<n; v++)
+		offset[v + 1] += offset[v];
+	int *next = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+	memcpy(next, offset, n * sizeof(int));
+	for (int e = 0; e<m; e++){
+		int k = next[edges[e].u]++;
+		adj[k] = edges[e].v;
+		if (weighted)
+			weight[k] = edges[e].w;
+	}
+	free(next);
+	free(edges);
+	double *x = NULL, *y = NULL;
+	if (argc - arg > 2){
+		x = (double*)calloc(2 * (size_t)n + 1, sizeof(double));
+		y = x + n;
+		if (!read_coordinates(argv[arg + 2], n, dimacs, x, y)){
+			printf("cannot read %s\n", argv[arg + 2]);
+			return 1;
+		}
+	}
+	graph_header h;
+	memset(&h, 0, sizeof(h));
+	h.magic = GRAPH_MAGIC;
+	h.version = 1;
+	h.n = n;
+	h.m = m;
+	h.flags = (weighted ? HAS_WEIGHTS : 0) | (x != NULL ? HAS_COORDS : 0);
+	FILE *f = fopen(argv[arg + 1], "wb");
+	if (f == NULL){
+		printf("cannot write %s\n", argv[arg + 1]);
+		return 1;
+	}
+	fwrite(&h, sizeof(h), 1, f);
+	fwrite(offset, sizeof(int), n + 1, f);
+	fwrite(adj, sizeof(int), m, f);
+	//pad the integers to a multiple of 8 bytes
+	if ((n + 1 + m) % 2 == 1){
+		int zero = 0;
+		fwrite(&zero, sizeof(int), 1, f);
+	}
+	if (weighted)
+		fwrite(weight, sizeof(double), m, f);
+	if (x != NULL)
+		fwrite(x, sizeof(double), 2 * (size_t)n, f);
+	if (fclose(f) != 0){
+		printf("cannot write %s\n", argv[arg + 1]);
+		return 1;
+	}
+	printf("%s: %d vertices, %d edges%s%s\n", argv[arg + 1], n, m,
+		weighted ? ", weights" : "", x != NULL ? ", coordinates" : "");
+	free(offset);
+	free(adj);
+	free(weight);
+	free(x);
+	return 0;
+}
@@ -1,62 +1,161 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
+//rows are evaluated TILE points at a time
+#define TILE 1024
+
+#pragma omp declare simd notinbranch
 double func(double x, double y) {
     //return -pow(x, 2) - pow(y, 2);
     
-    return -(pow(x-15, 2)) + 225
+    return -(pow(x-15, 2)) + 225;
 }
 
-void hill_climbing(double x_min, double x_max, double y_min, double y_max, double step) {
+//hill climbing moves on the lattice (x0 + i*step, y0 + j*step) around its
+//start point; the last values of func are kept in a small direct-mapped
+//cache keyed on (i, j), so the point we came from and the neighbors shared
+//by two steps are not evaluated again
+#define CACHE 64   //a power of 2
+#define STEEPEST 0 //move to the best neighbor
+#define FIRST 1    //move to the first neighbor that is better
+struct cache_entry{
+	int i, j;
+	int climb;     //climb that wrote the entry
+	double f;
+};
+struct climber{
+	double x0, y0, step;
+	int climb;
+	long calls;    //evaluations of func
+	cache_entry cache[CACHE];
+};
+climber climber_create(double step){
+	climber c;
+	memset(&c, 0, sizeof(c));
+	c.step = step;
+	return c;
+}
+//func at the lattice point (i, j)
+double value(climber &c, int i, int j){
+	cache_entry &e = c.cache[((unsigned)i * 0x9E3779B1u ^ (unsigned)j * 0x85EBCA77u) >> 16 & (CACHE - 1)];
+	if (e.climb != c.climb || e.i != i || e.j != j){
+		e.i = i;
+		e.j = j;
+		e.climb = c.climb;
+		e.f = func(c.x0 + i * c.step, c.y0 + j * c.step);
+		c.calls++;
+	}
+	return e.f;
+}
+//climb from (x, y) until no neighbor is better, returns the number of moves
+long climb(climber &c, double &x, double &y, double &f, int mode){
+	static const int di[4] = {1, -1, 0, 0};
+	static const int dj[4] = {0, 0, 1, -1};
+	c.x0 = x;
+	c.y0 = y;
+	c.climb++;
+	int i = 0, j = 0, last = 0;
+	long moves = 0;
+	f = value(c, 0, 0);
+	while (true){
+		int k_best = -1;
+		double f_max = f;
+		//first-improvement tries the last direction that worked first
+		for (int n = 0; n < 4; n++){
+			int k = (last + n) % 4;
+			double g = value(c, i + di[k], j + dj[k]);
+			if (f_max < g){
+				f_max = g;
+				k_best = k;
+				if (mode == FIRST)
+					break;
+			}
+		}
+		if (k_best < 0)
+			break;
+		if (mode == FIRST)
+			last = k_best;
+		i += di[k_best];
+		j += dj[k_best];
+		f = f_max;
+		moves++;
+	}
+	x = c.x0 + i * c.step;
+	y = c.y0 + j * c.step;
+	return moves;
+}
+
+void hill_climbing(double x_min, double x_max, double y_min, double y_max, double step, int mode) {
     //intitial values
     double x = x_min + (x_max - x_min) * ((double) rand() / RAND_MAX);
     double y = y_min + (y_max - y_min) * ((double) rand() / RAND_MAX);    
-    double f = func(x,y);
-    long int t = 0;
+    double f;
     //loops for finding best value
-		double f_max = f;
-		printf("hello");tep)][(int)y] == 0){ 
-        	f = func(x + step,y);
-        	x = x + step;
-		}	    if (f < func(x - step,y)){
-        	f = func(x - step,y);
-        	x = x - step;
-		}      	b[(int)x][(int)(y - step)] = 1;		
-		}     if (f < func(x,y + step)){
-        	f = func(x,y + step);
-        	y = y + step;
-		}
-        	f = func(x,y - step);
-        	y = y - step;
-		}exhausive search
+    climber c = climber_create(step);
+    long t = climb(c, x, y, f, mode);
+    // print
+    printf("Leo doi: sau %ld lap (%ld lan tinh ham), gia tri lon nhat la %f tai diem (%f, %f)\n", t, c.calls, f, x, y);
+}
+//exhausive search on the grid (x_min + i*step, y_min + j*step): the points
+//are computed from the indices so the grid does not drift, every thread takes
+//whole rows and evaluates them a tile at a time in SIMD lanes, and ties go to
+//the first point in row order as in the sequential loop
 void exhausive_search(double x_min, double x_max, double y_min, double y_max, double step) {
-	double x_best = x_min;
-	double y_best = y_min; 
-	double f_best = func(x_min,y_min);
-	long int t = 0;
-	for (double x = x_min; x <= x_max; x = x + step)
-		for (double y = y_min; y<= y_max; y = y + step){
-			double f = func(x,y);
-			if (f_best <f){
-				x_best = x;
-				y_best = y;
-				f_best = f;
-			}    
-			t++;
+	long nx = (long)((x_max - x_min) / step + 1e-9) + 1;
+	long ny = (long)((y_max - y_min) / step + 1e-9) + 1;
+	double f_best = -INFINITY;
+	long best = 0;
+	#pragma omp parallel
+	{
+		double values[TILE];
+		double f_local = -INFINITY;
+		long local = 0;
+		#pragma omp for schedule(static)
+		for (long i = 0; i < nx; i++){
+			double x = x_min + i * step;
+			for (long j0 = 0; j0 < ny; j0 += TILE){
+				int n = ny - j0 < TILE ? (int)(ny - j0) : TILE;
+				double f_max = -INFINITY;
+				#pragma omp simd reduction(max:f_max)
+				for (int j = 0; j < n; j++){
+					values[j] = func(x, y_min + (j0 + j) * step);
+					f_max = values[j] > f_max ? values[j] : f_max;
+				}
+				if (f_local < f_max){
+					int j = 0;
+					while (values[j] != f_max)
+						j++;
+					f_local = f_max;
+					local = i * ny + j0 + j;
+				}
+			}
+		}
+		#pragma omp critical
+		if (f_best < f_local || (f_best == f_local && local < best)){
+			f_best = f_local;
+			best = local;
 		}
+	}
+	long t = nx * ny;
+	double x_best = x_min + (best / ny) * step;
+	double y_best = y_min + (best % ny) * step;
 	 // print
     printf("Vet can: sau %ld lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
 }
-int main() {
+//usage: hill_climbing [-steepest]
+//  -steepest: steepest ascent instead of first-improvement hill climbing
+int main(int argc, char *argv[]) {
+    int mode = argc > 1 && strcmp(argv[1], "-steepest") == 0 ? STEEPEST : FIRST;
     //initialize parameters
     double x_min = -100, x_max = 100;
     double y_min = -100, y_max = 100;
     double step = 1;
     //exhausive search
     exhausive_search(x_min, x_max, y_min, y_max, step);
-    // hill climbi0.001g search
-    hill_climbing(x_min, x_max, y_min, y_max, step);
+    // hill climbing search
+    hill_climbing(x_min, x_max, y_min, y_max, step, mode);
     return 0;
 }
 
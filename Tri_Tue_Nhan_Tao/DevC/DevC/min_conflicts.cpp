@@ -1,103 +1,559 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#ifdef _WIN32
 #include <windows.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#define Sleep(ms) usleep((ms) * 1000)   // the output is paced the same way off Windows
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define NUM_VERTICES 1100
 #define NUM_COLORS 200
 #define MAX_STEPs 90000
+#define ALIGN 64   // buffers start on a cache line
+// parallel portfolio of tabu walkers
+#define WALK_STEPS 20000000   // steps of one walker before it gives up
+#define RESTART 200000        // steps without a better assignment before a restart
+#define TABU_TENURE 10        // minimum steps a vertex cannot go back to its old color
+#define NOISE 0.02            // probability of a random color instead of the best one
 
-// function to implement the min-conflicts algorithm for map coloring
-bool min_conflicts(char graph[][NUM_VERTICES], int colors[]) {    
+typedef unsigned long long word;
+
+// allocate size bytes aligned to ALIGN and filled with zeros
+void *aligned_calloc(size_t size) {
+    void *p;
+#ifdef _WIN32
+    p = _aligned_malloc(size > 0 ? size : 1, ALIGN);
+#else
+    if (posix_memalign(&p, ALIGN, size > 0 ? size : 1) != 0)
+        p = NULL;
+#endif
+    if (p == NULL) {
+        printf("\n out of memory (%lu bytes)\n", (unsigned long)size);
+        exit(1);
+    }
+    memset(p, 0, size);
+    return p;
+}
+
+void aligned_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// bit-packed adjacency matrix: bit j of row i is set when i and j are adjacent,
+// one bit per pair instead of one char
+struct bit_graph {
+    int n, words;   // words per row, rounded up so every row is aligned
+    word *bits;
+};
+
+bit_graph graph_create(int n) {
+    bit_graph g;
+    int per_line = ALIGN / sizeof(word);
+    g.n = n;
+    g.words = ((n + 63) / 64 + per_line - 1) / per_line * per_line;
+    g.bits = (word*)aligned_calloc((size_t)n * g.words * sizeof(word));
+    return g;
+}
+
+void graph_free(bit_graph &g) {
+    aligned_free(g.bits);
+}
+
+word *row(bit_graph &g, int i) {
+    return g.bits + (size_t)i * g.words;
+}
+
+void add_edge(bit_graph &g, int i, int j) {
+    row(g, i)[j >> 6] |= 1ULL << (j & 63);
+    row(g, j)[i >> 6] |= 1ULL << (i & 63);
+}
+
+// random graph, every pair is an edge with probability density
+bit_graph random_graph(int n, double density) {
+    bit_graph g = graph_create(n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < i; j++)
+            if (rand() < density * ((double)RAND_MAX + 1))
+                add_edge(g, i, j);
+    return g;
+}
+
+// read a DIMACS coloring file: "p edge n m" and edges "e u v" with vertices
+// from 1, lines starting with c are comments
+bool read_col(const char *file, bit_graph &g) {
+    FILE *f = fopen(file, "r");
+    if (f == NULL)
+        return false;
+    char line[256];
+    g.n = -1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        int u, v;
+        if (line[0] == 'p' && g.n < 0) {
+            char kind[16];
+            if (sscanf(line, "p %15s %d", kind, &u) != 2 || u < 0)
+                break;
+            g = graph_create(u);
+        }
+        else if (line[0] == 'e' && g.n >= 0 && sscanf(line, "e %d %d", &u, &v) == 2) {
+            if (u < 1 || u > g.n || v < 1 || v > g.n) {
+                printf("\n bad edge: %s", line);
+                graph_free(g);
+                g.n = -1;
+                break;
+            }
+            if (u != v)
+                add_edge(g, u - 1, v - 1);
+        }
+    }
+    fclose(f);
+    return g.n >= 0;
+}
+
+// number of bits set in both a and b
+int common(const word *a, const word *b, int words) {
+    int s = 0;
+    for (int w = 0; w < words; w++)
+        s += __builtin_popcountll(a[w] & b[w]);
+    return s;
+}
+
+// conflict table: count[i*num_colors + c] is the number of neighbors of i
+// with color c, members[c] is the bitset of the vertices with color c,
+// X holds the conflicted vertices and where[i] is the position of i in X
+// (-1 if i has no conflict)
+struct conflict_table {
+    int num_colors;
+    int *count;
+    word *members;
+    int *X, *where, k;
+};
+
+// put vertex i into the conflicted set
+void mark(conflict_table &t, int i) {
+    if (t.where[i] < 0) {
+        t.where[i] = t.k;
+        t.X[t.k++] = i;
+    }
+}
+
+// take vertex i out of the conflicted set, the last vertex fills its place
+void unmark(conflict_table &t, int i) {
+    int p = t.where[i];
+    if (p >= 0) {
+        int last = t.X[--t.k];
+        t.X[p] = last;
+        t.where[last] = p;
+        t.where[i] = -1;
+    }
+}
+
+// build the counts, the color classes and the conflicted set for colors[]
+conflict_table table_create(bit_graph &g, int k, int colors[]) {
+    conflict_table t;
+    t.num_colors = k;
+    t.count = (int*)aligned_calloc((size_t)g.n * k * sizeof(int));
+    t.members = (word*)aligned_calloc((size_t)k * g.words * sizeof(word));
+    t.X = (int*)aligned_calloc(g.n * sizeof(int));
+    t.where = (int*)aligned_calloc(g.n * sizeof(int));
+    t.k = 0;
+    for (int i = 0; i < g.n; i++) {
+        t.members[colors[i] * g.words + (i >> 6)] |= 1ULL << (i & 63);
+        word *r = row(g, i);
+        for (int w = 0; w < g.words; w++) {
+            // walk the set bits of the row
+            for (word x = r[w]; x != 0; x &= x - 1) {
+                int j = w * 64 + __builtin_ctzll(x);
+                t.count[(size_t)i * t.num_colors + colors[j]]++;
+            }
+        }
+    }
+    for (int i = 0; i < g.n; i++) {
+        t.where[i] = -1;
+        if (t.count[(size_t)i * t.num_colors + colors[i]] > 0)
+            mark(t, i);
+    }
+    return t;
+}
+
+void table_free(conflict_table &t) {
+    aligned_free(t.count);
+    aligned_free(t.members);
+    aligned_free(t.X);
+    aligned_free(t.where);
+}
+
+// change the color of vertex i to c, only i and its neighbors are updated
+void recolor(bit_graph &g, conflict_table &t, int colors[], int i, int c) {
+    int old = colors[i];
+    colors[i] = c;
+    t.members[old * g.words + (i >> 6)] &= ~(1ULL << (i & 63));
+    t.members[c * g.words + (i >> 6)] |= 1ULL << (i & 63);
+    word *r = row(g, i);
+    for (int w = 0; w < g.words; w++) {
+        for (word x = r[w]; x != 0; x &= x - 1) {
+            int j = w * 64 + __builtin_ctzll(x);
+            int *cj = t.count + (size_t)j * t.num_colors;
+            cj[old]--;
+            cj[c]++;
+            if (colors[j] == old && cj[old] == 0)
+                unmark(t, j);
+            else if (colors[j] == c && cj[c] == 1)
+                mark(t, j);
+        }
+    }
+    if (t.count[(size_t)i * t.num_colors + c] > 0)
+        mark(t, i);
+    else
+        unmark(t, i);
+}
+
+// number of edges whose two ends have the same color, each color class is
+// ANDed with the rows of its vertices
+int count_conflicts(bit_graph &g, conflict_table &t, int colors[]) {
+    int s = 0;
+    for (int i = 0; i < g.n; i++)
+        s += common(row(g, i), t.members + colors[i] * g.words, g.words);
+    return s / 2;
+}
+
+// function to implement the min-conflicts algorithm for map coloring with k colors,
+// keep = true starts from the assignment already in colors[]
+bool min_conflicts(bit_graph &g, int k, int colors[], bool keep) {    
     //initialize a complete assignment
-    for (int i = 0; i < NUM_VERTICES; i++) {
-        colors[i] = rand() % NUM_COLORS;
+    for (int i = 0; i < g.n && !keep; i++) {
+        colors[i] = rand() % k;
     }
+    // the conflict counts are kept up to date, so a step costs O(degree + colors)
+    conflict_table ct = table_create(g, k, colors);
 	//loop for finding a solution
-    for (int t = 1; t<= MAX_STEPs; t++) {
-    	// find a set of conflicted variables
-    	int X[NUM_VERTICES], k = 0; 
-    	for (int i = 0; i < NUM_VERTICES; i++) { 
-		    for (int j = 0; j < NUM_VERTICES; j++) {
-		        if (graph[i][j] == 1 && colors[i] == colors[j]) {
-		          	X[k] = i;
-		          	k++;
-		        }
-		    }
-		}			
+    for (int t = 1; t <= MAX_STEPs; t++) {
 		// check a solution	
-        if (k == 0){		
+        if (ct.k == 0){		
+            table_free(ct);
 			return true;        
         }        
-        // select a random vertex
-        int r = rand() % k; 
-        int i = X[r];
+        // select a random conflicted vertex
+        int r = rand() % ct.k; 
+        int i = ct.X[r];
         int color = colors[i];        
-        // count the number of conflicts for the current color assignment
-        int numConflicts = 0;
-        for (int j = 0; j < NUM_VERTICES; j++) {
-            if (i != j && graph[i][j] == 1 && colors[i] == colors[j]) {
-                numConflicts++;
+        // select the color that minimizes conflicts
+        int *ci = ct.count + (size_t)i * k;
+        int minConflicts = ci[color];
+        for (int c = 0; c < k; c++) {
+            if (ci[c] < minConflicts) {
+                minConflicts = ci[c];
+                color = c;
             }
         }
-        // select the color that minimizes conflicts
-        int minConflicts = numConflicts;
-        for (int c = 0; c < NUM_COLORS; c++) {
-            if (c != colors[i]) {
-                int conflicts = 0;
-                for (int j = 0; j < NUM_VERTICES; j++) {
-                    if (i != j && graph[i][j] == 1 && c == colors[j]) {
-                        conflicts++;
-                    }
-                }
-                if (conflicts < minConflicts) {
-                    minConflicts = conflicts;
+        // assign the color to the vertex i
+        if (color != colors[i])
+            recolor(g, ct, colors, i, color);
+    }
+    bool found = count_conflicts(g, ct, colors) == 0;
+    table_free(ct);
+    return found;
+}
+
+// xorshift random numbers, one generator per walker
+word next_random(word &state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+// random integer in [0, n)
+int random_below(word &state, int n) {
+    return (int)((next_random(state) >> 32) * n >> 32);
+}
+
+// one walker of the portfolio: min-conflicts with a tabu list, noise and
+// restarts, it starts from start[] (random if NULL) and stops when done is
+// set by another walker
+bool walk(bit_graph &g, int k, int colors[], const int start[], word seed, volatile int &done) {
+    word rng = seed;
+    // tabu[i*k + c] is the first step at which i may take color c again
+    int *tabu = (int*)aligned_calloc((size_t)g.n * k * sizeof(int));
+    for (int i = 0; i < g.n; i++)
+        colors[i] = start != NULL ? start[i] : random_below(rng, k);
+    conflict_table ct = table_create(g, k, colors);
+    int edges = count_conflicts(g, ct, colors);
+    int best = edges, last_better = 0;
+    for (int t = 1; t <= WALK_STEPS && ct.k > 0 && !done; t++) {
+        if (t - last_better > RESTART) {
+            // start again from a new random assignment
+            table_free(ct);
+            for (int i = 0; i < g.n; i++)
+                colors[i] = random_below(rng, k);
+            memset(tabu, 0, (size_t)g.n * k * sizeof(int));
+            ct = table_create(g, k, colors);
+            edges = count_conflicts(g, ct, colors);
+            best = edges;
+            last_better = t;
+            continue;
+        }
+        int i = ct.X[random_below(rng, ct.k)];
+        int old = colors[i];
+        int *ci = ct.count + (size_t)i * k;
+        int *ti = tabu + (size_t)i * k;
+        int color = -1;
+        if (k > 1 && (next_random(rng) >> 11) * (1.0 / 9007199254740992.0) < NOISE) {
+            // random walk step
+            color = random_below(rng, k - 1);
+            if (color >= old)
+                color++;
+        }
+        else {
+            // best color that is not tabu, a tabu color is allowed when it
+            // gives a better assignment than any seen (aspiration), ties are
+            // broken at random
+            int min = -1, ties = 0;
+            for (int c = 0; c < k; c++) {
+                if (c == old)
+                    continue;
+                if (ti[c] > t && edges + ci[c] - ci[old] >= best)
+                    continue;
+                if (min < 0 || ci[c] < min) {
+                    min = ci[c];
                     color = c;
+                    ties = 1;
                 }
+                else if (ci[c] == min && random_below(rng, ++ties) == 0)
+                    color = c;
             }
         }
-        // assign the color to the vertex i
-        colors[i] = color;        
+        if (color < 0)
+            continue;
+        edges += ci[color] - ci[old];
+        ti[old] = t + TABU_TENURE + random_below(rng, 10);
+        recolor(g, ct, colors, i, color);
+        if (edges < best) {
+            best = edges;
+            last_better = t;
+        }
+    }
+    bool found = ct.k == 0;
+    table_free(ct);
+    aligned_free(tabu);
+    return found;
+}
+
+// run walkers independent walks in parallel, the first one to find a
+// coloring copies it to colors[] and stops the others; keep = true starts
+// every walker from the assignment already in colors[]
+bool min_conflicts_parallel(bit_graph &g, int k, int colors[], int walkers, word seed, bool keep) {
+    volatile int done = 0;
+    int *start = NULL;
+    if (keep) {
+        start = (int*)aligned_calloc(g.n * sizeof(int));
+        memcpy(start, colors, g.n * sizeof(int));
     }
-    return false;
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int w = 0; w < walkers; w++) {
+        if (done)
+            continue;
+        int *own = (int*)aligned_calloc(g.n * sizeof(int));
+        // a different nonzero seed for every walker
+        word s = (seed + (word)(w + 1) * 0x9E3779B97F4A7C15ULL) | 1;
+        if (walk(g, k, own, start, s, done) && __sync_bool_compare_and_swap(&done, 0, 1))
+            memcpy(colors, own, g.n * sizeof(int));
+        aligned_free(own);
+    }
+    if (start != NULL)
+        aligned_free(start);
+    return done != 0;
+}
+
+// order of the greedy coloring
+struct by_degree {
+    int degree, v;
+};
+
+int compare_degree(const void *a, const void *b) {
+    const by_degree *x = (const by_degree*)a, *y = (const by_degree*)b;
+    if (x->degree != y->degree)
+        return y->degree - x->degree;
+    return x->v - y->v;
 }
 
-int main() {
+// greedy coloring (Welsh-Powell): the vertices by decreasing degree take the
+// first color that none of their neighbors has, returns the number of colors
+int greedy(bit_graph &g, int colors[]) {
+    by_degree *order = (by_degree*)aligned_calloc(g.n * sizeof(by_degree));
+    for (int v = 0; v < g.n; v++) {
+        order[v].v = v;
+        order[v].degree = common(row(g, v), row(g, v), g.words);
+    }
+    qsort(order, g.n, sizeof(by_degree), compare_degree);
+    // members + c * g.words is the bitset of the vertices with color c
+    word *members = (word*)aligned_calloc((size_t)g.n * g.words * sizeof(word));
+    int k = 0;
+    for (int i = 0; i < g.n; i++) {
+        int v = order[i].v, c = 0;
+        while (c < k && common(row(g, v), members + (size_t)c * g.words, g.words) > 0)
+            c++;
+        if (c == k)
+            k++;
+        colors[v] = c;
+        members[(size_t)c * g.words + (v >> 6)] |= 1ULL << (v & 63);
+    }
+    aligned_free(members);
+    aligned_free(order);
+    return k;
+}
+
+// turn a k-coloring into an assignment with k-1 colors: the smallest color
+// class takes the last color and its vertices move, one by one, to the color
+// with the fewest neighbors; all other vertices keep their colors
+void drop_color(bit_graph &g, int k, int colors[]) {
+    int *size = (int*)aligned_calloc(k * sizeof(int));
+    for (int v = 0; v < g.n; v++)
+        size[colors[v]]++;
+    int drop = 0;
+    for (int c = 1; c < k; c++)
+        if (size[c] < size[drop])
+            drop = c;
+    word *members = (word*)aligned_calloc((size_t)k * g.words * sizeof(word));
+    for (int v = 0; v < g.n; v++) {
+        if (colors[v] == drop)
+            colors[v] = k - 1;
+        else if (colors[v] == k - 1)
+            colors[v] = drop;
+        members[(size_t)colors[v] * g.words + (v >> 6)] |= 1ULL << (v & 63);
+    }
+    for (int v = 0; v < g.n; v++) {
+        if (colors[v] != k - 1)
+            continue;
+        int best = 0, min = -1;
+        for (int c = 0; c < k - 1; c++) {
+            int n = common(row(g, v), members + (size_t)c * g.words, g.words);
+            if (min < 0 || n < min) {
+                min = n;
+                best = c;
+            }
+        }
+        colors[v] = best;
+        members[(size_t)best * g.words + (v >> 6)] |= 1ULL << (v & 63);
+    }
+    aligned_free(members);
+    aligned_free(size);
+}
+
+// chromatic number mode: a greedy coloring gives the first number of colors
+// k, then k-1 colors are tried from the k-coloring with one color dropped,
+// until the solver fails; returns the fewest colors found, colors[] holds
+// that coloring
+int fewest_colors(bit_graph &g, int colors[], int walkers, word seed) {
+    int k = greedy(g, colors);
+    printf("\n greedy: %d colors", k);
+    int *trial = (int*)aligned_calloc(g.n * sizeof(int));
+    while (k > 1) {
+        memcpy(trial, colors, g.n * sizeof(int));
+        drop_color(g, k, trial);
+        bool found;
+        if (walkers > 0)
+            found = min_conflicts_parallel(g, k - 1, trial, walkers, seed + k, true);
+        else
+            found = min_conflicts(g, k - 1, trial, true);
+        if (!found)
+            break;
+        memcpy(colors, trial, g.n * sizeof(int));
+        k--;
+        printf("\n found: %d colors", k);
+    }
+    aligned_free(trial);
+    return k;
+}
+
+// usage: min_conflicts [-p walkers] [-c] [graph.col | -r vertices density] [colors]
+// without arguments a random graph with NUM_VERTICES vertices is colored
+// with NUM_COLORS colors, -p runs a portfolio of walkers in parallel
+// (0 walkers = one per thread), -c looks for the fewest colors
+int main(int argc, char *argv[]) {
 	srand(time(0));
-    //example adjacency matrix representing a graph with 5 vertices and 5 colors
-    /*
-	char graph[NUM_VERTICES][NUM_VERTICES] = {
-        {0, 1, 1, 0, 0},
-        {1, 0, 1, 0, 0},
-        {1, 1, 0, 1, 0},
-        {0, 0, 1, 0, 1},
-        {0, 0, 0, 1, 0}
-    };
-    */
-    // create a random graph
-    char  graph[NUM_VERTICES][NUM_VERTICES];
-    for (int i = 0; i<NUM_VERTICES; i++){
-    	for (int j = 0; j<=i; j++){
-    		graph[i][j] = rand() % 2;    		
-    		graph[j][i] = graph[i][j];
-    		graph[i][i] = 0;    		
-		}
-	}
+    bit_graph g;
+    int k = NUM_COLORS;
+    int walkers = -1;
+    bool fewest = false;
+    while (argc > 1 && argv[1][0] == '-' && argv[1][1] != 'r') {
+        if (strcmp(argv[1], "-c") == 0) {
+            fewest = true;
+            argc--;
+            argv++;
+        }
+        else if (strcmp(argv[1], "-p") == 0 && argc > 2) {
+            walkers = atoi(argv[2]);
+#ifdef _OPENMP
+            if (walkers <= 0)
+                walkers = omp_get_max_threads();
+#endif
+            if (walkers <= 0)
+                walkers = 1;
+            argc -= 2;
+            argv += 2;
+        }
+        else
+            break;
+    }
+    if (argc > 3 && strcmp(argv[1], "-r") == 0) {
+        // create a random graph of the given size
+        g = random_graph(atoi(argv[2]), atof(argv[3]));
+        if (argc > 4)
+            k = atoi(argv[4]);
+    }
+    else if (argc > 1) {
+        if (!read_col(argv[1], g)) {
+            printf("\n cannot load the graph %s\n", argv[1]);
+            return 1;
+        }
+        if (argc > 2)
+            k = atoi(argv[2]);
+    }
+    else {
+        // create a random graph
+        g = random_graph(NUM_VERTICES, 0.5);
+    }
+    if (k < 1) {
+        printf("\n the number of colors must be positive\n");
+        graph_free(g);
+        return 1;
+    }
 	/*
 	//print	
-	 for (int i = 0; i<NUM_VERTICES; i++){
-    	for (int j = 0; j<NUM_VERTICES; j++){
-    		printf("%5d",graph[i][j]);
+	 for (int i = 0; i<g.n; i++){
+    	for (int j = 0; j<g.n; j++){
+    		printf("%5d",(int)(row(g, i)[j >> 6] >> (j & 63) & 1));
     	}
     	printf("\n");
     }
     */
 	// initialize colors array
-    int colors[NUM_COLORS];
+    int *colors = (int*)aligned_calloc(g.n * sizeof(int));
     // run the min-conflicts algorithm
-    bool found = min_conflicts(graph, colors);
+    bool found;
+    word seed = (word)time(0) * 1000003 + rand();
+    if (fewest) {
+        k = fewest_colors(g, colors, walkers, seed);
+        printf("\n Colors: %d", k);
+        found = true;
+    }
+    else if (walkers > 0)
+        found = min_conflicts_parallel(g, k, colors, walkers, seed, false);
+    else
+        found = min_conflicts(g, k, colors, false);
     if (found) {
-     	for (int i = 0; i < NUM_VERTICES; i++) {
+     	for (int i = 0; i < g.n; i++) {
         	printf("\n Vertex %d <-- color %d", i, colors[i]);
         	Sleep(1);
     	}
@@ -105,6 +561,7 @@ int main() {
 	else {
 		printf("\n There exists no solution.\n");
 	}
+	aligned_free(colors);
+	graph_free(g);
 return 0;
 }
-
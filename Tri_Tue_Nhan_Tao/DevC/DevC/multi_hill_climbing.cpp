@@ -1,79 +1,301 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #define PI 3.14
 
+//rows are evaluated TILE points at a time
+#define TILE 1024
+
+#pragma omp declare simd notinbranch
 double func(double x, double y) {
    return - (sqrt((x-50)*(x-50) +4*(y-150)*(y-150))+20*cos(2*PI*x/30)+20*cos(2*PI*y/40));
 }
 
-void multi_start_hill_climbing(double x_min, double x_max, double y_min, double y_max, double step, int num_starts) {
-    //initialize the best values
-    double f_best = -INFINITY;
-    double x_best, y_best;
-    int t = 0;
-    //iteration num_starts hill-climbing
-    for (int i = 0; i < num_starts; i++) {
-        //initialize for each hill-climbing       
-        double x = x_min + (x_max - x_min) * ((double) rand() / RAND_MAX);
-        double y = y_min + (y_max - y_min) * ((double) rand() / RAND_MAX);
-        double f = func(x,y);
-        
-         //loops for finding best value
-	    while (true) {
-			double f_max = f; 
-	        if (f < func(x + step,y)){
-	        	f = func(x + step,y);
-	        	x = x + step;
-			}
-	        if (f < func(x - step,y)){
-	        	f = func(x - step,y);
-	        	x = x - step;
-			}		
-	        if (f < func(x,y + step)){
-	        	f = func(x,y + step);
-	        	y = y + step;
-			}
-	        if (f < func(x,y - step)){
-	        	f = func(x,y - step);
-	        	y = y - step;
+typedef unsigned long long word;
+
+//xorshift random numbers
+word next_random(word &state) {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+// a nonzero generator state from any number (splitmix)
+word seed_random(word x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x != 0 ? x : 1;
+}
+
+//cells of the search box that the climbs walked through, shared by all
+//threads: an open-addressing table of (cell + 1) << 32 | start, 0 is empty
+#define CELL 16            //a cell is CELL x CELL steps
+#define VISITED (1 << 20)  //a power of 2
+#define PROBES 32          //slots tried before a cell is left unmarked
+struct visited{
+	double x_min, y_min, cell;
+	long nx, ny;
+	volatile word *slots;
+};
+visited visited_create(double x_min, double x_max, double y_min, double y_max, double cell){
+	visited v;
+	//cell numbers must fit in 32 bits
+	while ((x_max - x_min) / cell * ((y_max - y_min) / cell) > 4e9)
+		cell *= 2;
+	v.x_min = x_min;
+	v.y_min = y_min;
+	v.cell = cell;
+	v.nx = (long)((x_max - x_min) / cell) + 1;
+	v.ny = (long)((y_max - y_min) / cell) + 1;
+	v.slots = (volatile word*)calloc(VISITED, sizeof(word));
+	return v;
+}
+void visited_free(visited &v){
+	free((void*)v.slots);
+}
+//cell of (x, y) + 1, 0 outside the box
+word cell_of(visited &v, double x, double y){
+	double a = (x - v.x_min) / v.cell;
+	double b = (y - v.y_min) / v.cell;
+	if (!(a >= 0 && a < v.nx && b >= 0 && b < v.ny))
+		return 0;
+	return (word)a * (word)v.ny + (word)b + 1;
+}
+//mark the cell for the start, returns the start that marked it first; a
+//point outside the box or a crowded table returns the start itself
+int claim(visited &v, word key, int start){
+	if (key == 0)
+		return start;
+	word h = key * 0x9E3779B97F4A7C15ULL >> 32;
+	for (int p = 0; p < PROBES; p++){
+		volatile word &slot = v.slots[(h + p) & (VISITED - 1)];
+		word e = slot;
+		if (e == 0){
+			if (__sync_bool_compare_and_swap(&slot, 0, key << 32 | (unsigned)start))
+				return start;
+			e = slot;
+		}
+		if (e >> 32 == key)
+			return (int)(e & 0xFFFFFFFF);
+	}
+	return start;
+}
+
+//hill climbing moves on the lattice (x0 + i*step, y0 + j*step) around its
+//start point; the last values of func are kept in a small direct-mapped
+//cache keyed on (i, j), so the point we came from and the neighbors shared
+//by two steps are not evaluated again
+#define CACHE 64   //a power of 2
+#define STEEPEST 0 //move to the best neighbor
+#define FIRST 1    //move to the first neighbor that is better
+struct cache_entry{
+	int i, j;
+	int climb;     //climb that wrote the entry
+	double f;
+};
+struct climber{
+	double x0, y0, step;
+	int climb;
+	long calls;    //evaluations of func
+	visited *seen; //cells walked by other starts, or NULL
+	int start;     //start that is climbing
+	bool merged;   //the climb stopped in a cell of an earlier start
+	cache_entry cache[CACHE];
+};
+climber climber_create(double step){
+	climber c;
+	memset(&c, 0, sizeof(c));
+	c.step = step;
+	return c;
+}
+//func at the lattice point (i, j)
+double value(climber &c, int i, int j){
+	cache_entry &e = c.cache[((unsigned)i * 0x9E3779B1u ^ (unsigned)j * 0x85EBCA77u) >> 16 & (CACHE - 1)];
+	if (e.climb != c.climb || e.i != i || e.j != j){
+		e.i = i;
+		e.j = j;
+		e.climb = c.climb;
+		e.f = func(c.x0 + i * c.step, c.y0 + j * c.step);
+		c.calls++;
+	}
+	return e.f;
+}
+//climb from (x, y) until no neighbor is better, returns the number of moves
+long climb(climber &c, double &x, double &y, double &f, int mode){
+	static const int di[4] = {1, -1, 0, 0};
+	static const int dj[4] = {0, 0, 1, -1};
+	c.x0 = x;
+	c.y0 = y;
+	c.climb++;
+	int i = 0, j = 0, last = 0;
+	long moves = 0;
+	f = value(c, 0, 0);
+	c.merged = false;
+	word cell = 0;
+	while (true){
+		//an earlier start went through this cell, its climb goes on from here
+		if (c.seen != NULL){
+			word key = cell_of(*c.seen, c.x0 + i * c.step, c.y0 + j * c.step);
+			if (key != cell){
+				cell = key;
+				if (claim(*c.seen, key, c.start) < c.start){
+					c.merged = true;
+					break;
+				}
 			}
-	        if (f == f_max){
-	        	break;
+		}
+		int k_best = -1;
+		double f_max = f;
+		//first-improvement tries the last direction that worked first
+		for (int n = 0; n < 4; n++){
+			int k = (last + n) % 4;
+			double g = value(c, i + di[k], j + dj[k]);
+			if (f_max < g){
+				f_max = g;
+				k_best = k;
+				if (mode == FIRST)
+					break;
 			}
-			t++;
-	    }    		
-        //keep the best values
-        if (f > f_best) {
-            f_best = f;
-            x_best = x;
-            y_best = y;
+		}
+		if (k_best < 0)
+			break;
+		if (mode == FIRST)
+			last = k_best;
+		i += di[k_best];
+		j += dj[k_best];
+		f = f_max;
+		moves++;
+	}
+	x = c.x0 + i * c.step;
+	y = c.y0 + j * c.step;
+	return moves;
+}
+
+//end point of a climb
+struct result{
+	double x, y, f;
+};
+//the starts run in parallel, start s draws its point from its own generator
+//seed_random(seed + s) so the points do not depend on the threads; a climb
+//that walks into a cell of an earlier start stops, and the best end point is
+//published with a compare-and-swap on its start number
+void multi_start_hill_climbing(double x_min, double x_max, double y_min, double y_max, double step, int num_starts, int mode, word seed) {
+    result *r = (result*)malloc(num_starts * sizeof(result));
+    volatile int best = -1;
+    long t = 0, calls = 0;
+    int merged = 0;
+    visited seen = visited_create(x_min, x_max, y_min, y_max, CELL * step);
+    #pragma omp parallel reduction(+:t,calls,merged)
+    {
+        climber c = climber_create(step);
+        c.seen = &seen;
+        #pragma omp for schedule(dynamic)
+        for (int s = 0; s < num_starts; s++) {
+            //initialize for each hill-climbing
+            word rng = seed_random(seed + s);
+            double x = x_min + (x_max - x_min) * ((next_random(rng) >> 11) * (1.0 / 9007199254740992.0));
+            double y = y_min + (y_max - y_min) * ((next_random(rng) >> 11) * (1.0 / 9007199254740992.0));
+            double f;
+            c.start = s;
+            t += climb(c, x, y, f, mode);
+            if (c.merged) {
+                merged++;
+                continue;
+            }
+            //keep the best values, ties go to the first start
+            r[s].x = x;
+            r[s].y = y;
+            r[s].f = f;
+            int b = best;
+            while ((b < 0 || r[b].f < f || (r[b].f == f && s < b)) && !__sync_bool_compare_and_swap(&best, b, s))
+                b = best;
         }
+        calls += c.calls;
     }
     // print results
-    printf("Leo doi: Sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
+    printf("Leo doi: %d lan khoi dong, %d lan dung som trong vung da tham\n", num_starts, merged);
+    printf("Leo doi: Sau %ld lap (%ld lan tinh ham), gia tri lon nhat la %f tai diem (%f, %f)\n", t, calls, r[best].f, r[best].x, r[best].y);
+    visited_free(seen);
+    free(r);
 }
 
+//exhausive search on the grid (x_min + i*step, y_min + j*step): the points
+//are computed from the indices so the grid does not drift, every thread takes
+//whole rows and evaluates them a tile at a time in SIMD lanes, and ties go to
+//the first point in row order as in the sequential loop
 void exhausive_search(double x_min, double x_max, double y_min, double y_max, double step) {
-	double x_best = x_min;
-	double y_best = y_min; 
-	double f_best = func(x_min,y_min);
-	int t = 0;
-	for (double x = x_min; x <= x_max; x = x + step)
-		for (double y = y_min; y<= y_max; y = y + step){
-			double f = func(x,y);
-			if (f_best <f){
-				x_best = x;
-				y_best = y;
-				f_best = f;
-			}    
-			t++;
+	long nx = (long)((x_max - x_min) / step + 1e-9) + 1;
+	long ny = (long)((y_max - y_min) / step + 1e-9) + 1;
+	double f_best = -INFINITY;
+	long best = 0;
+	#pragma omp parallel
+	{
+		double values[TILE];
+		double f_local = -INFINITY;
+		long local = 0;
+		#pragma omp for schedule(static)
+		for (long i = 0; i < nx; i++){
+			double x = x_min + i * step;
+			for (long j0 = 0; j0 < ny; j0 += TILE){
+				int n = ny - j0 < TILE ? (int)(ny - j0) : TILE;
+				double f_max = -INFINITY;
+				#pragma omp simd reduction(max:f_max)
+				for (int j = 0; j < n; j++){
+					values[j] = func(x, y_min + (j0 + j) * step);
+					f_max = values[j] > f_max ? values[j] : f_max;
+				}
+				if (f_local < f_max){
+					int j = 0;
+					while (values[j] != f_max)
+						j++;
+					f_local = f_max;
+					local = i * ny + j0 + j;
+				}
+			}
+		}
+		#pragma omp critical
+		if (f_best < f_local || (f_best == f_local && local < best)){
+			f_best = f_local;
+			best = local;
 		}
+	}
+	long t = nx * ny;
+	double x_best = x_min + (best / ny) * step;
+	double y_best = y_min + (best % ny) * step;
 	 // print results
-    printf("Vet can: sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
+    printf("Vet can: sau %ld lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
 }
 
-int main() {
+//usage: multi_hill_climbing [-steepest] [-s seed] [starts]
+//  -steepest: steepest ascent instead of first-improvement hill climbing
+//  starts: number of hill climbs, 50 by default
+int main(int argc, char *argv[]) {
+	int mode = FIRST;
+	word seed = 1;
+	while (argc > 1 && argv[1][0] == '-') {
+		if (strcmp(argv[1], "-steepest") == 0) {
+			mode = STEEPEST;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[1], "-s") == 0 && argc > 2) {
+			seed = strtoull(argv[2], NULL, 10);
+			argc -= 2;
+			argv += 2;
+		}
+		else
+			break;
+	}
+	// number of hill-climbing algorithm
+	int num_starts = argc > 1 ? atoi(argv[1]) : 50;
+	if (num_starts < 1) {
+		printf("starts >= 1\n");
+		return 1;
+	}
 	// initialize parameter values
 	double x_min = 0.0, x_max = 100.0;
     double y_min = 100, y_max = 200.0;
@@ -82,9 +304,7 @@ int main() {
 	//exhausive search
     exhausive_search(x_min, x_max, y_min, y_max, step);
     
-	// number of hill-climbing algorithm
-	int num_starts = 50;	
-	multi_start_hill_climbing(x_min, x_max, y_min, y_max, step, num_starts);
+	multi_start_hill_climbing(x_min, x_max, y_min, y_max, step, num_starts, mode, seed);
 	
 	return 0;
 }
@@ -9,7 +9,10 @@
 #define MIN_TEMP 1e-5
 #define NUM_NEIGHBORS 10
 #define PROB 0.01
+//the range is evaluated TILE points at a time
+#define TILE 1024
 
+#pragma omp declare simd notinbranch
 double func(double x)
 {
     //return -x * x/10 + 3*x;  //[0, 31]
@@ -41,22 +44,46 @@ void simulated_annealing(double x_min, double x_max){
         T *= COOLING_FACTOR;
         t++;
     }
-    printf("Simulated Annealing: Sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best);	
+    printf("Simulated Annealing: Sau %d lap, gia tri lon nhat la %f tai diem %f\n", t, f_best, x_best);	
 }
-//vet can
+//vet can: the point i is x_min + i*step, computed from the index so the grid
+//does not drift; the threads split the range into tiles that are evaluated in
+//SIMD lanes, ties go to the first point as in the sequential loop
 void exhausive_search(double x_min, double x_max, double step){
-	double x_best = x_min;
-	double f_best = func(x_min);
-	int t = 0;
-	for (double x = x_min; x <= x_max; x = x + step){
-		double f = func(x);
-		if (f_best < f){
-			x_best = x;
-			f_best = f;
-		 } 
-		t++;
+	long n = (long)((x_max - x_min) / step + 1e-9) + 1;
+	double f_best = -INFINITY;
+	long best = 0;
+	#pragma omp parallel
+	{
+		double values[TILE];
+		double f_local = -INFINITY;
+		long local = 0;
+		#pragma omp for schedule(static)
+		for (long i0 = 0; i0 < n; i0 += TILE){
+			int m = n - i0 < TILE ? (int)(n - i0) : TILE;
+			double f_max = -INFINITY;
+			#pragma omp simd reduction(max:f_max)
+			for (int i = 0; i < m; i++){
+				values[i] = func(x_min + (i0 + i) * step);
+				f_max = values[i] > f_max ? values[i] : f_max;
+			}
+			if (f_local < f_max){
+				int i = 0;
+				while (values[i] != f_max)
+					i++;
+				f_local = f_max;
+				local = i0 + i;
+			}
+		}
+		#pragma omp critical
+		if (f_best < f_local || (f_best == f_local && local < best)){
+			f_best = f_local;
+			best = local;
+		}
 	}
-	printf("Vet can: Sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best);	
+	long t = n;
+	double x_best = x_min + best * step;
+	printf("Vet can: Sau %ld lap, gia tri lon nhat la %f tai diem %f\n", t, f_best, x_best);	
 }
 int main()
 {
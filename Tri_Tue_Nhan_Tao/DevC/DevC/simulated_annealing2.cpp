@@ -11,6 +11,10 @@
 #define PROB 0.01
 #define PI 3.14
 
+//rows are evaluated TILE points at a time
+#define TILE 1024
+
+#pragma omp declare simd notinbranch
 double func(double x, double y){
     return - (sqrt((x-50)*(x-50) +4*(y-150)*(y-150))+20*cos(2*PI*x/30)+20*cos(2*PI*y/40));
 }
@@ -47,24 +51,51 @@ void simulated_annealing(double x_min, double y_min, double x_max, double y_max)
     }
     printf("Simulated Annealing: Sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);	
 }
-//vet can
+//exhausive search on the grid (x_min + i*step, y_min + j*step): the points
+//are computed from the indices so the grid does not drift, every thread takes
+//whole rows and evaluates them a tile at a time in SIMD lanes, and ties go to
+//the first point in row order as in the sequential loop
 void exhausive_search(double x_min, double x_max, double y_min, double y_max, double step) {
-	double x_best = x_min;
-	double y_best = y_min; 
-	double f_best = func(x_min,y_min);
-	int t = 0;
-	for (double x = x_min; x <= x_max; x = x + step)
-		for (double y = y_min; y<= y_max; y = y + step){
-			double f = func(x,y);
-			if (f_best <f){
-				x_best = x;
-				y_best = y;
-				f_best = f;
-			}    
-			t++;
+	long nx = (long)((x_max - x_min) / step + 1e-9) + 1;
+	long ny = (long)((y_max - y_min) / step + 1e-9) + 1;
+	double f_best = -INFINITY;
+	long best = 0;
+	#pragma omp parallel
+	{
+		double values[TILE];
+		double f_local = -INFINITY;
+		long local = 0;
+		#pragma omp for schedule(static)
+		for (long i = 0; i < nx; i++){
+			double x = x_min + i * step;
+			for (long j0 = 0; j0 < ny; j0 += TILE){
+				int n = ny - j0 < TILE ? (int)(ny - j0) : TILE;
+				double f_max = -INFINITY;
+				#pragma omp simd reduction(max:f_max)
+				for (int j = 0; j < n; j++){
+					values[j] = func(x, y_min + (j0 + j) * step);
+					f_max = values[j] > f_max ? values[j] : f_max;
+				}
+				if (f_local < f_max){
+					int j = 0;
+					while (values[j] != f_max)
+						j++;
+					f_local = f_max;
+					local = i * ny + j0 + j;
+				}
+			}
+		}
+		#pragma omp critical
+		if (f_best < f_local || (f_best == f_local && local < best)){
+			f_best = f_local;
+			best = local;
 		}
+	}
+	long t = nx * ny;
+	double x_best = x_min + (best / ny) * step;
+	double y_best = y_min + (best % ny) * step;
 	 // In k?t qu?
-    printf("Vet can: sau %d lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
+    printf("Vet can: sau %ld lap, gia tri lon nhat la %f tai diem (%f, %f)\n", t, f_best, x_best, y_best);
 }
 
 int main(){